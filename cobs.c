@@ -14,22 +14,647 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /*==============================================================================
  PRIVATE DEFINES
  =============================================================================*/
 #define COBS_BLOCK_SIZE (255U)
 #define COBS_FRAME_END (0U)
+#define COBS_RUN_MAX (COBS_BLOCK_SIZE - 1U)
+#define COBS_ZPE_RUN_MAX (0xDFU)
+#define COBS_ZPE_PAIR_CODE (0xE1U)
+#define COBS_ZPE_PAIR_RUN_MAX (0xFFU - COBS_ZPE_PAIR_CODE)
+
+#define COBS_KERNEL_ENV "COBS_KERNEL"
+#define COBS_SWAR_LOW_BITS (0x0101010101010101ULL)
+#define COBS_SWAR_HIGH_BITS (0x8080808080808080ULL)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/* All x86 kernels are built, the CPU is checked at run time. */
+#define COBS_SIMD_DISPATCH
+#define COBS_SIMD_AVX512BW
+#define COBS_SIMD_AVX2
+#define COBS_SIMD_SSE2
+#define COBS_TARGET(ISA) __attribute__((target(ISA)))
+#define COBS_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+/* Only the kernels enabled by the compiler flags are built. */
+#if defined(__AVX512BW__)
+#define COBS_SIMD_AVX512BW
+#endif
+#if defined(__AVX2__)
+#define COBS_SIMD_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define COBS_SIMD_SSE2
+#endif
+#define COBS_TARGET(ISA)
+#if defined(_MSC_VER)
+#define COBS_ALWAYS_INLINE __forceinline
+#else
+#define COBS_ALWAYS_INLINE inline
+#endif
+#endif
 
 /*==============================================================================
- PUBLIC FUNCTIONS
+ PRIVATE INCLUDES
  =============================================================================*/
+#if defined(COBS_SIMD_AVX512BW) || defined(COBS_SIMD_AVX2)
+#include <immintrin.h>
+#elif defined(COBS_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-size_t cobs_encode(const void *vp_in, size_t s_in_size,
-                   uint8_t *u8p_out, size_t s_out_size)
+/*==============================================================================
+ PRIVATE TYPES
+ =============================================================================*/
+
+/** Copies non-zero bytes up to the first zero, returns the number copied. */
+typedef size_t (*cobs_run_t)(const uint8_t *u8p_in, size_t s_size,
+                             uint8_t *u8p_out);
+
+/** Returns the index of the first zero, or s_size if there is none. */
+typedef size_t (*cobs_scan_t)(const uint8_t *u8p_in, size_t s_size);
+
+/** Encoder and decoder built for one instruction set. */
+typedef struct
 {
-    assert(vp_in && u8p_out);
+    const char *cp_name;
+    int (*fp_supported)(void);
+    cobs_run_t fp_run;
+    cobs_scan_t fp_scan;
+    size_t (*fp_encode)(const void *vp_in, size_t s_in_size,
+                        uint8_t *u8p_out, size_t s_out_size);
+    size_t (*fp_decode)(const uint8_t *u8p_in, size_t s_in_size,
+                        void *vp_out, size_t s_out_size);
+    size_t (*fp_encoded_size)(const void *vp_in, size_t s_in_size);
+} cobs_kernel_t;
+
+/*==============================================================================
+ PRIVATE FUNCTIONS
+ =============================================================================*/
+
+/**
+ * @brief Count trailing zero bits of a non-zero mask
+ * @param u32_mask Mask to scan, must not be zero
+ * @return Index of the lowest set bit
+ */
+static inline unsigned cobs_ctz32(uint32_t u32_mask)
+{
+#if defined(_MSC_VER)
+    unsigned long ul_index;
+    _BitScanForward(&ul_index, u32_mask);
+    return (unsigned)ul_index;
+#elif defined(__GNUC__)
+    return (unsigned)__builtin_ctz(u32_mask);
+#else
+    unsigned u_index = 0;
+    while ((u32_mask & 1U) == 0U)
+    {
+        u32_mask >>= 1;
+        u_index++;
+    }
+    return u_index;
+#endif
+}
+
+/**
+ * @brief Count trailing zero bits of a non-zero 64-bit mask
+ * @param u64_mask Mask to scan, must not be zero
+ * @return Index of the lowest set bit
+ */
+static inline unsigned cobs_ctz64(uint64_t u64_mask)
+{
+    uint32_t u32_low = (uint32_t)u64_mask;
+
+    return (u32_low != 0U) ? cobs_ctz32(u32_low) : 32U + cobs_ctz32((uint32_t)(u64_mask >> 32));
+}
+
+/**
+ * @brief Copy non-zero bytes one at a time
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to copy
+ * @param u8p_out Pointer to output data
+ * @return Number of bytes copied, i.e. index of the first zero or s_size
+ */
+static inline size_t cobs_run_scalar(const uint8_t *u8p_in, size_t s_size,
+                                     uint8_t *u8p_out)
+{
+    size_t s_pos;
+
+    for (s_pos = 0; (s_pos < s_size) && (u8p_in[s_pos] != 0U); s_pos++)
+    {
+        u8p_out[s_pos] = u8p_in[s_pos];
+    }
+    return s_pos;
+}
+
+/**
+ * @brief Copy non-zero bytes with memchr and memmove
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to copy
+ * @param u8p_out Pointer to output data
+ * @return Number of bytes copied, i.e. index of the first zero or s_size
+ * @note The output may overlap the input, see cobs_decode_inplace().
+ */
+static inline size_t cobs_run_memchr(const uint8_t *u8p_in, size_t s_size,
+                                     uint8_t *u8p_out)
+{
+    const uint8_t *u8p_zero = (const uint8_t *)memchr(u8p_in, 0, s_size);
+    size_t s_run = (u8p_zero != NULL) ? (size_t)(u8p_zero - u8p_in) : s_size;
+
+    memmove(u8p_out, u8p_in, s_run);
+    return s_run;
+}
+
+/**
+ * @brief Find the first zero with memchr
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to scan
+ * @return Index of the first zero or s_size
+ */
+static inline size_t cobs_scan_memchr(const uint8_t *u8p_in, size_t s_size)
+{
+    const uint8_t *u8p_zero = (const uint8_t *)memchr(u8p_in, 0, s_size);
+
+    return (u8p_zero != NULL) ? (size_t)(u8p_zero - u8p_in) : s_size;
+}
+
+/**
+ * @brief Copy non-zero bytes 8 at a time
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to copy
+ * @param u8p_out Pointer to output data
+ * @return Number of bytes copied, i.e. index of the first zero or s_size
+ * @note Portable C, uses the "has zero byte" bit trick on 64-bit words. The
+ * word containing a zero is finished byte by byte, so the result does not
+ * depend on endianness.
+ */
+static inline size_t cobs_run_swar(const uint8_t *u8p_in, size_t s_size,
+                                   uint8_t *u8p_out)
+{
+    size_t s_pos = 0;
+
+    while ((s_size - s_pos) >= sizeof(uint64_t))
+    {
+        uint64_t u64_data;
+        memcpy(&u64_data, u8p_in + s_pos, sizeof(u64_data));
+        if (((u64_data - COBS_SWAR_LOW_BITS) & ~u64_data & COBS_SWAR_HIGH_BITS) != 0U)
+        {
+            /* Zero found. */
+            break;
+        }
+        memcpy(u8p_out + s_pos, &u64_data, sizeof(u64_data));
+        s_pos += sizeof(uint64_t);
+    }
+    return s_pos + cobs_run_scalar(u8p_in + s_pos, s_size - s_pos, u8p_out + s_pos);
+}
+
+/**
+ * @brief Find the first zero 8 bytes at a time
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to scan
+ * @return Index of the first zero or s_size
+ */
+static inline size_t cobs_scan_swar(const uint8_t *u8p_in, size_t s_size)
+{
+    size_t s_pos = 0;
+
+    while ((s_size - s_pos) >= sizeof(uint64_t))
+    {
+        uint64_t u64_data;
+        memcpy(&u64_data, u8p_in + s_pos, sizeof(u64_data));
+        if (((u64_data - COBS_SWAR_LOW_BITS) & ~u64_data & COBS_SWAR_HIGH_BITS) != 0U)
+        {
+            /* Zero found. */
+            break;
+        }
+        s_pos += sizeof(uint64_t);
+    }
+    while ((s_pos < s_size) && (u8p_in[s_pos] != 0U))
+    {
+        s_pos++;
+    }
+    return s_pos;
+}
+
+/**
+ * @brief Copy bytes up to a stop byte 8 at a time, XORing them
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to copy
+ * @param u8p_out Pointer to output data
+ * @param u8_stop Byte value that ends the run
+ * @param u8_xor Value XORed into every copied byte
+ * @return Number of bytes copied, i.e. index of the first stop byte or s_size
+ * @note Used for frames with a delimiter other than zero, the delimiter is
+ * swapped with zero while the run is copied.
+ */
+static inline size_t cobs_run_xor(const uint8_t *u8p_in, size_t s_size, uint8_t *u8p_out,
+                                  uint8_t u8_stop, uint8_t u8_xor)
+{
+    const uint64_t u64_stop = COBS_SWAR_LOW_BITS * u8_stop; // Stop byte in every lane
+    const uint64_t u64_xor = COBS_SWAR_LOW_BITS * u8_xor;   // XOR byte in every lane
+    size_t s_pos = 0;
+
+    while ((s_size - s_pos) >= sizeof(uint64_t))
+    {
+        uint64_t u64_data;
+        uint64_t u64_cmp;
+        memcpy(&u64_data, u8p_in + s_pos, sizeof(u64_data));
+        u64_cmp = u64_data ^ u64_stop;
+        if (((u64_cmp - COBS_SWAR_LOW_BITS) & ~u64_cmp & COBS_SWAR_HIGH_BITS) != 0U)
+        {
+            /* Stop byte found. */
+            break;
+        }
+        u64_data ^= u64_xor;
+        memcpy(u8p_out + s_pos, &u64_data, sizeof(u64_data));
+        s_pos += sizeof(uint64_t);
+    }
+    while ((s_pos < s_size) && (u8p_in[s_pos] != u8_stop))
+    {
+        u8p_out[s_pos] = u8p_in[s_pos] ^ u8_xor;
+        s_pos++;
+    }
+    return s_pos;
+}
+
+#if defined(COBS_SIMD_SSE2)
+/**
+ * @brief Copy non-zero bytes 16 at a time
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to copy
+ * @param u8p_out Pointer to output data
+ * @return Number of bytes copied, i.e. index of the first zero or s_size
+ */
+COBS_TARGET("sse2")
+static inline size_t cobs_run_sse2(const uint8_t *u8p_in, size_t s_size,
+                                   uint8_t *u8p_out)
+{
+    const __m128i v_zero = _mm_setzero_si128();
+    size_t s_pos = 0;
+
+    while ((s_size - s_pos) >= sizeof(__m128i))
+    {
+        __m128i v_data = _mm_loadu_si128((const __m128i *)(u8p_in + s_pos));
+        uint32_t u32_mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v_data, v_zero));
+        if (u32_mask != 0U)
+        {
+            /* Zero found, copy the bytes in front of it. */
+            return s_pos + cobs_run_scalar(u8p_in + s_pos, cobs_ctz32(u32_mask),
+                                           u8p_out + s_pos);
+        }
+        _mm_storeu_si128((__m128i *)(u8p_out + s_pos), v_data);
+        s_pos += sizeof(__m128i);
+    }
+    return s_pos + cobs_run_scalar(u8p_in + s_pos, s_size - s_pos, u8p_out + s_pos);
+}
+
+/**
+ * @brief Find the first zero 16 bytes at a time
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to scan
+ * @return Index of the first zero or s_size
+ */
+COBS_TARGET("sse2")
+static inline size_t cobs_scan_sse2(const uint8_t *u8p_in, size_t s_size)
+{
+    const __m128i v_zero = _mm_setzero_si128();
+    size_t s_pos = 0;
+
+    while ((s_size - s_pos) >= sizeof(__m128i))
+    {
+        __m128i v_data = _mm_loadu_si128((const __m128i *)(u8p_in + s_pos));
+        uint32_t u32_mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v_data, v_zero));
+        if (u32_mask != 0U)
+        {
+            return s_pos + cobs_ctz32(u32_mask);
+        }
+        s_pos += sizeof(__m128i);
+    }
+    return s_pos + cobs_scan_memchr(u8p_in + s_pos, s_size - s_pos);
+}
+#endif /* COBS_SIMD_SSE2 */
+
+#if defined(COBS_SIMD_AVX2)
+/**
+ * @brief Copy non-zero bytes 32 at a time
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to copy
+ * @param u8p_out Pointer to output data
+ * @return Number of bytes copied, i.e. index of the first zero or s_size
+ */
+COBS_TARGET("avx2")
+static inline size_t cobs_run_avx2(const uint8_t *u8p_in, size_t s_size,
+                                   uint8_t *u8p_out)
+{
+    const __m256i v_zero = _mm256_setzero_si256();
+    size_t s_pos = 0;
+
+    while ((s_size - s_pos) >= sizeof(__m256i))
+    {
+        __m256i v_data = _mm256_loadu_si256((const __m256i *)(u8p_in + s_pos));
+        uint32_t u32_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v_data, v_zero));
+        if (u32_mask != 0U)
+        {
+            /* Zero found, copy the bytes in front of it. */
+            return s_pos + cobs_run_sse2(u8p_in + s_pos, cobs_ctz32(u32_mask),
+                                         u8p_out + s_pos);
+        }
+        _mm256_storeu_si256((__m256i *)(u8p_out + s_pos), v_data);
+        s_pos += sizeof(__m256i);
+    }
+    return s_pos + cobs_run_sse2(u8p_in + s_pos, s_size - s_pos, u8p_out + s_pos);
+}
+
+/**
+ * @brief Find the first zero 32 bytes at a time
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to scan
+ * @return Index of the first zero or s_size
+ */
+COBS_TARGET("avx2")
+static inline size_t cobs_scan_avx2(const uint8_t *u8p_in, size_t s_size)
+{
+    const __m256i v_zero = _mm256_setzero_si256();
+    size_t s_pos = 0;
+
+    while ((s_size - s_pos) >= sizeof(__m256i))
+    {
+        __m256i v_data = _mm256_loadu_si256((const __m256i *)(u8p_in + s_pos));
+        uint32_t u32_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v_data, v_zero));
+        if (u32_mask != 0U)
+        {
+            return s_pos + cobs_ctz32(u32_mask);
+        }
+        s_pos += sizeof(__m256i);
+    }
+    return s_pos + cobs_scan_sse2(u8p_in + s_pos, s_size - s_pos);
+}
+#endif /* COBS_SIMD_AVX2 */
+
+#if defined(COBS_SIMD_AVX512BW)
+/**
+ * @brief Copy non-zero bytes 64 at a time
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to copy
+ * @param u8p_out Pointer to output data
+ * @return Number of bytes copied, i.e. index of the first zero or s_size
+ * @note The last partial vector uses masked loads and stores, so there is
+ * no scalar remainder loop and nothing is accessed past s_size.
+ */
+COBS_TARGET("avx512bw")
+static inline size_t cobs_run_avx512bw(const uint8_t *u8p_in, size_t s_size,
+                                       uint8_t *u8p_out)
+{
+    const __m512i v_zero = _mm512_setzero_si512();
+    size_t s_pos = 0;
+
+    for (;;)
+    {
+        size_t s_left = s_size - s_pos;
+        __mmask64 k_data = (s_left >= sizeof(__m512i)) ? ~(__mmask64)0
+                                                       : (((__mmask64)1 << s_left) - 1U);
+        __m512i v_data = _mm512_maskz_loadu_epi8(k_data, u8p_in + s_pos);
+        __mmask64 k_zero = _mm512_mask_cmpeq_epi8_mask(k_data, v_data, v_zero);
+        if (k_zero != 0U)
+        {
+            /* Zero found, copy the bytes in front of it. */
+            unsigned u_zero = cobs_ctz64(k_zero);
+            _mm512_mask_storeu_epi8(u8p_out + s_pos, ((__mmask64)1 << u_zero) - 1U, v_data);
+            return s_pos + u_zero;
+        }
+        _mm512_mask_storeu_epi8(u8p_out + s_pos, k_data, v_data);
+        if (s_left <= sizeof(__m512i))
+        {
+            return s_size;
+        }
+        s_pos += sizeof(__m512i);
+    }
+}
+
+/**
+ * @brief Find the first zero 64 bytes at a time
+ * @param u8p_in Pointer to input data
+ * @param s_size Maximum number of bytes to scan
+ * @return Index of the first zero or s_size
+ */
+COBS_TARGET("avx512bw")
+static inline size_t cobs_scan_avx512bw(const uint8_t *u8p_in, size_t s_size)
+{
+    const __m512i v_zero = _mm512_setzero_si512();
+    size_t s_pos = 0;
+
+    for (;;)
+    {
+        size_t s_left = s_size - s_pos;
+        __mmask64 k_data = (s_left >= sizeof(__m512i)) ? ~(__mmask64)0
+                                                       : (((__mmask64)1 << s_left) - 1U);
+        __m512i v_data = _mm512_maskz_loadu_epi8(k_data, u8p_in + s_pos);
+        __mmask64 k_zero = _mm512_mask_cmpeq_epi8_mask(k_data, v_data, v_zero);
+        if (k_zero != 0U)
+        {
+            return s_pos + cobs_ctz64(k_zero);
+        }
+        if (s_left <= sizeof(__m512i))
+        {
+            return s_size;
+        }
+        s_pos += sizeof(__m512i);
+    }
+}
+#endif /* COBS_SIMD_AVX512BW */
+
+/**
+ * @brief COBS encode data block by block
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @param u8p_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @param fp_run Run function of the kernel
+ * @return Encoded buffer size in bytes
+ * @note Produces the same output as the byte-wise encoder. Code bytes are
+ * only written at zero positions and block limits, the runs in between are
+ * copied by the run function.
+ */
+static COBS_ALWAYS_INLINE size_t cobs_encode_block(const void *vp_in, size_t s_in_size,
+                                                   uint8_t *u8p_out, size_t s_out_size,
+                                                   cobs_run_t fp_run)
+{
+    const uint8_t *u8p_in = (const uint8_t *)vp_in;    // Input data pointer
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;    // Input end pointer
+    const uint8_t *u8p_out_end = u8p_out + s_out_size; // Output end pointer
+    uint8_t *u8p_out_code = u8p_out;                   // Code byte pointer
+
+    while (u8p_out_code < u8p_out_end)
+    {
+        size_t s_in_left = (size_t)(u8p_in_end - u8p_in);
+        size_t s_out_left = (size_t)(u8p_out_end - u8p_out_code) - 1U;
+        size_t s_run_max = (s_in_left < COBS_RUN_MAX) ? s_in_left : COBS_RUN_MAX;
+        size_t s_run_lim = (s_run_max < s_out_left) ? s_run_max : s_out_left;
+        size_t s_run = fp_run(u8p_in, s_run_lim, u8p_out_code + 1);
+        if (s_run < s_run_lim)
+        {
+            /* Encode zero. */
+            *u8p_out_code = (uint8_t)(s_run + 1U);
+            u8p_out_code += s_run + 1U;
+            u8p_in += s_run + 1U;
+        }
+        else if (s_run < s_run_max)
+        {
+            /* Output buffer too small. */
+            break;
+        }
+        else if (s_run < s_in_left)
+        {
+            /* Encode end of block. */
+            *u8p_out_code = COBS_BLOCK_SIZE;
+            u8p_out_code += COBS_BLOCK_SIZE;
+            u8p_in += s_run;
+        }
+        else if (s_run < s_out_left)
+        {
+            /* Frame End */
+            *u8p_out_code = (uint8_t)(s_run + 1U);
+            u8p_out_code += s_run + 1U;
+            *u8p_out_code = COBS_FRAME_END;
+            return (size_t)(u8p_out_code + 1 - u8p_out);
+        }
+        else
+        {
+            /* No space left for the frame end. */
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief COBS decode data block by block
+ * @param u8p_in Pointer to encoded input bytes
+ * @param s_in_size Size of input data
+ * @param vp_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @param fp_run Run function of the kernel
+ * @return Number of bytes successfully decoded
+ * @note Returns the same as the byte-wise decoder. Jumps from code byte to
+ * code byte, the run in between is copied and checked for zeros by the run
+ * function.
+ */
+static COBS_ALWAYS_INLINE size_t cobs_decode_block(const uint8_t *u8p_in, size_t s_in_size,
+                                                   void *vp_out, size_t s_out_size,
+                                                   cobs_run_t fp_run)
+{
+    uint8_t *u8p_out = (uint8_t *)vp_out;              // Output data pointer
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;    // Input end pointer
+    const uint8_t *u8p_out_end = u8p_out + s_out_size; // Output end pointer
+    const uint8_t *u8p_out_start = u8p_out;            // Output start pointer
+    uint8_t u8_in_code_mem;                            // Last code
+    size_t s_code_left;                                // Run length to next code
+
+    if (s_in_size == 0U)
+    {
+        return 0;
+    }
+    u8_in_code_mem = *u8p_in;
+    /* A leading zero never matches a code byte, the rest is copied as is. */
+    s_code_left = (u8_in_code_mem != COBS_FRAME_END) ? (size_t)u8_in_code_mem - 1U : s_in_size;
+    u8p_in++;
+
+    for (;;)
+    {
+        size_t s_in_left = (size_t)(u8p_in_end - u8p_in);
+        size_t s_out_left = (size_t)(u8p_out_end - u8p_out);
+        size_t s_run_max = (s_code_left < s_in_left) ? s_code_left : s_in_left;
+        size_t s_run_lim = (s_run_max < s_out_left) ? s_run_max : s_out_left;
+        size_t s_run = fp_run(u8p_in, s_run_lim, u8p_out);
+        u8p_in += s_run;
+        u8p_out += s_run;
+        if (s_run == s_in_left)
+        {
+            /* Input ended without frame end. */
+            break;
+        }
+        if (*u8p_in == COBS_FRAME_END)
+        {
+            /* Frame End */
+            u8p_in++;
+            u8_in_code_mem = COBS_FRAME_END;
+            break;
+        }
+        if ((s_run < s_run_max) || (u8p_out == u8p_out_end))
+        {
+            /* Output buffer too small. */
+            return 0;
+        }
+        /* Decode code byte. */
+        if (u8_in_code_mem != COBS_BLOCK_SIZE)
+        {
+            /* Decode zero byte. */
+            *u8p_out = 0;
+            u8p_out++;
+        }
+        u8_in_code_mem = *u8p_in;
+        s_code_left = (size_t)u8_in_code_mem - 1U;
+        u8p_in++;
+    }
+    /* Diangostics */
+    if ((u8p_in == u8p_in_end) && (u8_in_code_mem == COBS_FRAME_END))
+    {
+        /* Verify that all data was decoded and the last byte was 0 */
+        return (size_t)(u8p_out - u8p_out_start);
+    }
+    return 0;
+}
 
+/**
+ * @brief Compute the exact COBS encoded size run by run
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @param fp_scan Scan function of the kernel
+ * @return Encoded size in bytes including the frame end
+ * @note Every zero is replaced by a code byte, so only the extra code bytes
+ * of runs longer than a block add to the input size.
+ */
+static COBS_ALWAYS_INLINE size_t cobs_encoded_size_block(const void *vp_in, size_t s_in_size,
+                                                         cobs_scan_t fp_scan)
+{
+    const uint8_t *u8p_in = (const uint8_t *)vp_in; // Input data pointer
+    size_t s_size = s_in_size + 2U;                 // First code byte and frame end
+    size_t s_pos = 0;                               // Input position
+
+    for (;;)
+    {
+        size_t s_run = fp_scan(u8p_in + s_pos, s_in_size - s_pos);
+        if ((s_pos + s_run) == s_in_size)
+        {
+            /* A full last block needs no further code byte. */
+            s_size += (s_run != 0U) ? (s_run - 1U) / COBS_RUN_MAX : 0U;
+            break;
+        }
+        s_size += s_run / COBS_RUN_MAX;
+        s_pos += s_run + 1U;
+    }
+    return s_size;
+}
+
+
+/**
+ * @brief COBS encode data byte by byte
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @param u8p_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @return Encoded buffer size in bytes
+ */
+static size_t cobs_encode_scalar(const void *vp_in, size_t s_in_size,
+                                 uint8_t *u8p_out, size_t s_out_size)
+{
     const uint8_t *u8p_in = (const uint8_t *)vp_in;    // Input data pointer
     const uint8_t *u8p_in_end = u8p_in + s_in_size;    // Input end pointer
     const uint8_t *u8p_out_end = u8p_out + s_out_size; // Output end pointer
@@ -85,58 +710,1110 @@ size_t cobs_encode(const void *vp_in, size_t s_in_size,
     return ret;
 }
 
-size_t cobs_decode(const uint8_t *u8p_in, size_t s_in_size,
-                   void *vp_out, size_t s_out_size)
+/**
+ * @brief COBS decode data run by run
+ * @param u8p_in Pointer to encoded input bytes
+ * @param s_in_size Size of input data
+ * @param vp_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @return Number of bytes successfully decoded
+ */
+static size_t cobs_decode_scalar(const uint8_t *u8p_in, size_t s_in_size,
+                                 void *vp_out, size_t s_out_size)
 {
-    assert(u8p_in && vp_out);
+    return cobs_decode_block(u8p_in, s_in_size, vp_out, s_out_size, cobs_run_memchr);
+}
 
-    uint8_t *u8p_out = (uint8_t *)vp_out;              // Output data pointer
-    const uint8_t *u8p_in_end = u8p_in + s_in_size;    // Input end pointer
-    const uint8_t *u8p_out_end = u8p_out + s_out_size; // Input end pointer
-    const uint8_t *u8p_out_start = u8p_out;            // Output start pointer
-    const uint8_t *u8p_in_code = u8p_in + *u8p_in;     // Code byte pointer
-    uint8_t u8_in_code_mem = *u8p_in;                  // Last code
-    size_t ret = 0;                                    // Return value
+static size_t cobs_encoded_size_scalar(const void *vp_in, size_t s_in_size)
+{
+    return cobs_encoded_size_block(vp_in, s_in_size, cobs_scan_memchr);
+}
 
-    for (u8p_in++; u8p_in < u8p_in_end; u8p_in++)
-    {
-        if ((*u8p_in != COBS_FRAME_END) && (u8p_out < u8p_out_end))
-        {
-            /* Frame ongoing */
-            if ((u8p_in == u8p_in_code) && (*u8p_in_code != COBS_FRAME_END))
-            {
-                /* Decode code byte. */
-                if (u8_in_code_mem != COBS_BLOCK_SIZE)
-                {
-                    /* Decode zero byte. */
-                    *u8p_out = 0;
-                    u8p_out++;
-                }
-                u8p_in_code = u8p_in + *u8p_in;
-                u8_in_code_mem = *u8p_in;
-            }
-            else
-            {
-                /* Decode non-zero byte. */
-                *u8p_out = *u8p_in;
-                u8p_out++;
-            }
-        }
-        else
-        {
-            /* Frame End */
-            u8_in_code_mem = *u8p_in;
-            u8p_in++;
-            break;
-        }
-    }
-    /* Diangostics */
-    if ((u8p_in == u8p_in_end) && (u8_in_code_mem == COBS_FRAME_END))
-    {
-        /* Verify that all data was decoded and the last byte was 0 */
-        ret = (size_t)(u8p_out - u8p_out_start);
-    }
-    return ret;
+static int cobs_supported_always(void)
+{
+    return 1;
+}
+
+static size_t cobs_encode_swar(const void *vp_in, size_t s_in_size,
+                               uint8_t *u8p_out, size_t s_out_size)
+{
+    return cobs_encode_block(vp_in, s_in_size, u8p_out, s_out_size, cobs_run_swar);
+}
+
+static size_t cobs_decode_swar(const uint8_t *u8p_in, size_t s_in_size,
+                               void *vp_out, size_t s_out_size)
+{
+    return cobs_decode_block(u8p_in, s_in_size, vp_out, s_out_size, cobs_run_swar);
+}
+
+static size_t cobs_encoded_size_swar(const void *vp_in, size_t s_in_size)
+{
+    return cobs_encoded_size_block(vp_in, s_in_size, cobs_scan_swar);
+}
+
+#if defined(COBS_SIMD_SSE2)
+COBS_TARGET("sse2")
+static size_t cobs_encode_sse2(const void *vp_in, size_t s_in_size,
+                               uint8_t *u8p_out, size_t s_out_size)
+{
+    return cobs_encode_block(vp_in, s_in_size, u8p_out, s_out_size, cobs_run_sse2);
+}
+
+COBS_TARGET("sse2")
+static size_t cobs_decode_sse2(const uint8_t *u8p_in, size_t s_in_size,
+                               void *vp_out, size_t s_out_size)
+{
+    return cobs_decode_block(u8p_in, s_in_size, vp_out, s_out_size, cobs_run_sse2);
+}
+
+COBS_TARGET("sse2")
+static size_t cobs_encoded_size_sse2(const void *vp_in, size_t s_in_size)
+{
+    return cobs_encoded_size_block(vp_in, s_in_size, cobs_scan_sse2);
+}
+#endif /* COBS_SIMD_SSE2 */
+
+#if defined(COBS_SIMD_AVX2)
+COBS_TARGET("avx2")
+static size_t cobs_encode_avx2(const void *vp_in, size_t s_in_size,
+                               uint8_t *u8p_out, size_t s_out_size)
+{
+    return cobs_encode_block(vp_in, s_in_size, u8p_out, s_out_size, cobs_run_avx2);
+}
+
+COBS_TARGET("avx2")
+static size_t cobs_decode_avx2(const uint8_t *u8p_in, size_t s_in_size,
+                               void *vp_out, size_t s_out_size)
+{
+    return cobs_decode_block(u8p_in, s_in_size, vp_out, s_out_size, cobs_run_avx2);
+}
+
+COBS_TARGET("avx2")
+static size_t cobs_encoded_size_avx2(const void *vp_in, size_t s_in_size)
+{
+    return cobs_encoded_size_block(vp_in, s_in_size, cobs_scan_avx2);
+}
+#endif /* COBS_SIMD_AVX2 */
+
+#if defined(COBS_SIMD_AVX512BW)
+COBS_TARGET("avx512bw")
+static size_t cobs_encode_avx512bw(const void *vp_in, size_t s_in_size,
+                                   uint8_t *u8p_out, size_t s_out_size)
+{
+    return cobs_encode_block(vp_in, s_in_size, u8p_out, s_out_size, cobs_run_avx512bw);
+}
+
+COBS_TARGET("avx512bw")
+static size_t cobs_decode_avx512bw(const uint8_t *u8p_in, size_t s_in_size,
+                                   void *vp_out, size_t s_out_size)
+{
+    return cobs_decode_block(u8p_in, s_in_size, vp_out, s_out_size, cobs_run_avx512bw);
+}
+
+COBS_TARGET("avx512bw")
+static size_t cobs_encoded_size_avx512bw(const void *vp_in, size_t s_in_size)
+{
+    return cobs_encoded_size_block(vp_in, s_in_size, cobs_scan_avx512bw);
+}
+#endif /* COBS_SIMD_AVX512BW */
+
+#if defined(COBS_SIMD_DISPATCH)
+static int cobs_supported_sse2(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+static int cobs_supported_avx2(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static int cobs_supported_avx512bw(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512bw");
+}
+#else
+/* Kernels are only built when the compiler targets their instruction set. */
+#define cobs_supported_sse2 cobs_supported_always
+#define cobs_supported_avx2 cobs_supported_always
+#define cobs_supported_avx512bw cobs_supported_always
+#endif
+
+/*==============================================================================
+ PRIVATE VARIABLES
+ =============================================================================*/
+
+/** Available kernels, best first. */
+static const cobs_kernel_t cobs_kernels[] = {
+#if defined(COBS_SIMD_AVX512BW)
+    {"avx512bw", cobs_supported_avx512bw, cobs_run_avx512bw, cobs_scan_avx512bw,
+     cobs_encode_avx512bw, cobs_decode_avx512bw,
+     cobs_encoded_size_avx512bw},
+#endif
+#if defined(COBS_SIMD_AVX2)
+    {"avx2", cobs_supported_avx2, cobs_run_avx2, cobs_scan_avx2,
+     cobs_encode_avx2, cobs_decode_avx2,
+     cobs_encoded_size_avx2},
+#endif
+#if defined(COBS_SIMD_SSE2)
+    {"sse2", cobs_supported_sse2, cobs_run_sse2, cobs_scan_sse2,
+     cobs_encode_sse2, cobs_decode_sse2,
+     cobs_encoded_size_sse2},
+#endif
+    {"swar", cobs_supported_always, cobs_run_swar, cobs_scan_swar,
+     cobs_encode_swar, cobs_decode_swar,
+     cobs_encoded_size_swar},
+    {"scalar", cobs_supported_always, cobs_run_memchr, cobs_scan_memchr,
+     cobs_encode_scalar, cobs_decode_scalar,
+     cobs_encoded_size_scalar},
+};
+
+/** Selected kernel, NULL until the first use. */
+static const cobs_kernel_t *cobs_kernel = NULL;
+
+/*==============================================================================
+ KERNEL SELECTION
+ =============================================================================*/
+
+/**
+ * @brief Find a kernel supported by this CPU
+ * @param cp_name Kernel name, or NULL for the best one
+ * @return Pointer to the kernel, NULL if unknown or not supported
+ */
+static const cobs_kernel_t *cobs_kernel_find(const char *cp_name)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(cobs_kernels) / sizeof(cobs_kernels[0]); i++)
+    {
+        if (((cp_name == NULL) || (strcmp(cp_name, cobs_kernels[i].cp_name) == 0)) &&
+            cobs_kernels[i].fp_supported())
+        {
+            return &cobs_kernels[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Select the kernel at load time
+ * @note Honours the COBS_KERNEL environment variable, unknown or unsupported
+ * names fall back to the best kernel for this CPU.
+ */
+#if defined(__GNUC__)
+__attribute__((constructor))
+#endif
+static void cobs_kernel_init(void)
+{
+    const char *cp_name = getenv(COBS_KERNEL_ENV);
+    const cobs_kernel_t *sp_kernel = (cp_name != NULL) ? cobs_kernel_find(cp_name) : NULL;
+
+    cobs_kernel = (sp_kernel != NULL) ? sp_kernel : cobs_kernel_find(NULL);
+}
+
+/**
+ * @brief Get the selected kernel
+ * @return Pointer to the kernel
+ */
+static inline const cobs_kernel_t *cobs_kernel_get(void)
+{
+    if (cobs_kernel == NULL)
+    {
+        /* Compilers without constructors select on first use. */
+        cobs_kernel_init();
+    }
+    return cobs_kernel;
+}
+
+/*==============================================================================
+ PUBLIC FUNCTIONS
+ =============================================================================*/
+
+const char *cobs_kernel_name(void)
+{
+    return cobs_kernel_get()->cp_name;
+}
+
+int cobs_kernel_set(const char *cp_name)
+{
+    const cobs_kernel_t *sp_kernel = cobs_kernel_find(cp_name);
+
+    if (sp_kernel == NULL)
+    {
+        return 0;
+    }
+    cobs_kernel = sp_kernel;
+    return 1;
+}
+
+size_t cobs_encode(const void *vp_in, size_t s_in_size,
+                   uint8_t *u8p_out, size_t s_out_size)
+{
+    assert(vp_in && u8p_out);
+
+    return cobs_kernel_get()->fp_encode(vp_in, s_in_size, u8p_out, s_out_size);
+}
+
+uint8_t *cobs_encode_reserve(uint8_t *u8p_buf, size_t s_buf_size, size_t s_payload_max)
+{
+    assert(u8p_buf);
+
+    if (s_buf_size < COBS_ENCODE_OUT_SIZE_MIN(s_payload_max))
+    {
+        return NULL;
+    }
+    return u8p_buf + COBS_ENCODE_HEADROOM(s_payload_max);
+}
+
+size_t cobs_encode_commit(uint8_t *u8p_buf, size_t s_buf_size,
+                          size_t s_payload_max, size_t s_payload_size)
+{
+    assert(u8p_buf);
+
+    if (s_payload_size > s_payload_max)
+    {
+        return 0;
+    }
+    /* Each code byte moves the output one byte closer to the input, the
+       headroom covers all of them, so every run is copied forward. */
+    return cobs_kernel_get()->fp_encode(u8p_buf + COBS_ENCODE_HEADROOM(s_payload_max),
+                                        s_payload_size, u8p_buf, s_buf_size);
+}
+
+size_t cobs_encode_many(const cobs_iovec_t *sp_in, size_t s_count,
+                        uint8_t *u8p_out, size_t s_out_size,
+                        size_t *sp_offsets)
+{
+    assert(sp_in && u8p_out);
+
+    const cobs_kernel_t *sp_kernel = cobs_kernel_get(); // Selected kernel
+    size_t s_out_need = 0;                              // Worst case output size
+    size_t s_out_pos = 0;                               // Output position
+    size_t i;
+
+    /* Size the output once, so no frame can run out of space below. */
+    for (i = 0; i < s_count; i++)
+    {
+        size_t s_frame_max = COBS_ENCODE_OUT_SIZE_MIN(sp_in[i].s_len);
+        if (s_frame_max > (s_out_size - s_out_need))
+        {
+            return 0;
+        }
+        s_out_need += s_frame_max;
+    }
+    for (i = 0; i < s_count; i++)
+    {
+        size_t s_size = sp_kernel->fp_encode(sp_in[i].vp_base, sp_in[i].s_len, u8p_out + s_out_pos,
+                                             COBS_ENCODE_OUT_SIZE_MIN(sp_in[i].s_len));
+        if (sp_offsets != NULL)
+        {
+            sp_offsets[i] = s_out_pos;
+        }
+        s_out_pos += s_size;
+    }
+    return s_out_pos;
+}
+
+size_t cobs_encodev(const cobs_iovec_t *sp_in, size_t s_count,
+                    uint8_t *u8p_out, size_t s_out_size)
+{
+    assert(sp_in && u8p_out);
+
+    cobs_encoder_t s_enc; // Encoder state
+    size_t i;
+
+    cobs_encoder_begin(&s_enc, u8p_out, s_out_size);
+    for (i = 0; (i < s_count) && !s_enc.i_error; i++)
+    {
+        (void)cobs_encoder_update(&s_enc, sp_in[i].vp_base, sp_in[i].s_len);
+    }
+    return cobs_encoder_finish(&s_enc);
+}
+
+size_t cobs_decode(const uint8_t *u8p_in, size_t s_in_size,
+                   void *vp_out, size_t s_out_size)
+{
+    assert(u8p_in && vp_out);
+
+    return cobs_kernel_get()->fp_decode(u8p_in, s_in_size, vp_out, s_out_size);
+}
+
+size_t cobs_decode_inplace(uint8_t *u8p_buf, size_t s_size)
+{
+    assert(u8p_buf);
+
+    /* The output always trails the input, every run is copied forward. */
+    return cobs_kernel_get()->fp_decode(u8p_buf, s_size, u8p_buf, s_size);
+}
+
+size_t cobs_decodev(const uint8_t *u8p_in, size_t s_in_size,
+                    const cobs_iovec_t *sp_out, size_t s_count)
+{
+    assert(u8p_in && sp_out);
+
+    const uint8_t *u8p_in_end = u8p_in + s_in_size; // Input end pointer
+    cobs_run_t fp_run = cobs_kernel_get()->fp_run;  // Run function
+    uint8_t *u8p_out = NULL;                        // Output data pointer
+    const uint8_t *u8p_out_end = NULL;              // Segment end pointer
+    const cobs_iovec_t *sp_seg = sp_out;            // Next segment
+    size_t s_out_left = 0;                          // Output space in all segments
+    size_t s_size = 0;                              // Decoded size
+    uint8_t u8_in_code_mem;                         // Last code
+    size_t s_code_left;                             // Run length to next code
+    size_t i;
+
+    for (i = 0; i < s_count; i++)
+    {
+        s_out_left += sp_out[i].s_len;
+    }
+    if (s_in_size == 0U)
+    {
+        return 0;
+    }
+    u8_in_code_mem = *u8p_in;
+    /* A leading zero never matches a code byte, the rest is copied as is. */
+    s_code_left = (u8_in_code_mem != COBS_FRAME_END) ? (size_t)u8_in_code_mem - 1U : s_in_size;
+    u8p_in++;
+
+    for (;;)
+    {
+        size_t s_in_left = (size_t)(u8p_in_end - u8p_in);
+        size_t s_run_max = (s_code_left < s_in_left) ? s_code_left : s_in_left;
+        size_t s_run_lim = (s_run_max < s_out_left) ? s_run_max : s_out_left;
+        size_t s_run = 0;
+        while (s_run < s_run_lim)
+        {
+            if (u8p_out == u8p_out_end)
+            {
+                /* Continue in the next segment. */
+                u8p_out = (uint8_t *)sp_seg->vp_base;
+                u8p_out_end = u8p_out + sp_seg->s_len;
+                sp_seg++;
+                continue;
+            }
+            size_t s_seg_left = (size_t)(u8p_out_end - u8p_out);
+            size_t s_lim = ((s_run_lim - s_run) < s_seg_left) ? (s_run_lim - s_run) : s_seg_left;
+            size_t s_copied = fp_run(u8p_in, s_lim, u8p_out);
+            u8p_in += s_copied;
+            u8p_out += s_copied;
+            s_run += s_copied;
+            if (s_copied < s_lim)
+            {
+                break;
+            }
+        }
+        s_out_left -= s_run;
+        s_size += s_run;
+        if (s_run == s_in_left)
+        {
+            /* Input ended without frame end. */
+            break;
+        }
+        if (*u8p_in == COBS_FRAME_END)
+        {
+            /* Frame End */
+            u8p_in++;
+            u8_in_code_mem = COBS_FRAME_END;
+            break;
+        }
+        if ((s_run < s_run_max) || (s_out_left == 0U))
+        {
+            /* Output segments too small. */
+            return 0;
+        }
+        /* Decode code byte. */
+        if (u8_in_code_mem != COBS_BLOCK_SIZE)
+        {
+            /* Decode zero byte. */
+            while (u8p_out == u8p_out_end)
+            {
+                u8p_out = (uint8_t *)sp_seg->vp_base;
+                u8p_out_end = u8p_out + sp_seg->s_len;
+                sp_seg++;
+            }
+            *u8p_out = 0;
+            u8p_out++;
+            s_out_left--;
+            s_size++;
+        }
+        u8_in_code_mem = *u8p_in;
+        s_code_left = (size_t)u8_in_code_mem - 1U;
+        u8p_in++;
+    }
+    if ((u8p_in == u8p_in_end) && (u8_in_code_mem == COBS_FRAME_END))
+    {
+        /* Verify that all data was decoded and the last byte was 0 */
+        return s_size;
+    }
+    return 0;
+}
+
+size_t cobs_r_encode(const void *vp_in, size_t s_in_size,
+                     uint8_t *u8p_out, size_t s_out_size)
+{
+    assert(vp_in && u8p_out);
+
+    size_t s_size = cobs_kernel_get()->fp_encode(vp_in, s_in_size, u8p_out, s_out_size);
+    size_t s_pos = 0; // Code byte position
+
+    if (s_size == 0U)
+    {
+        return 0;
+    }
+    /* Find the last code byte, it points at the frame end. */
+    while ((s_pos + u8p_out[s_pos]) < (s_size - 1U))
+    {
+        s_pos += u8p_out[s_pos];
+    }
+    if ((u8p_out[s_pos] > 1U) && (u8p_out[s_size - 2U] >= u8p_out[s_pos]))
+    {
+        /* The last data byte points past the frame end, it replaces the code. */
+        u8p_out[s_pos] = u8p_out[s_size - 2U];
+        u8p_out[s_size - 2U] = COBS_FRAME_END;
+        s_size--;
+    }
+    return s_size;
+}
+
+size_t cobs_r_decode(const uint8_t *u8p_in, size_t s_in_size,
+                     void *vp_out, size_t s_out_size)
+{
+    assert(u8p_in && vp_out);
+
+    size_t s_pos = 0;                         // Code byte position
+    size_t s_last = 0;                        // Last code byte position
+    size_t s_size = 0;                        // Expected decoded size
+    size_t s_out;                             // Decoded size
+    uint8_t u8_in_code_mem = COBS_BLOCK_SIZE; // Last code
+
+    if ((s_in_size < 2U) || (u8p_in[0] == COBS_FRAME_END) ||
+        (u8p_in[s_in_size - 1U] != COBS_FRAME_END))
+    {
+        /* Raw or unterminated frames are never reduced. */
+        return cobs_decode(u8p_in, s_in_size, vp_out, s_out_size);
+    }
+    while (s_pos < (s_in_size - 1U))
+    {
+        if (u8p_in[s_pos] == COBS_FRAME_END)
+        {
+            /* Frame end where a code byte is expected. */
+            return 0;
+        }
+        if (u8_in_code_mem != COBS_BLOCK_SIZE)
+        {
+            /* Zero byte of the previous block. */
+            s_size++;
+        }
+        u8_in_code_mem = u8p_in[s_pos];
+        s_size += (size_t)u8_in_code_mem - 1U;
+        s_last = s_pos;
+        s_pos += u8_in_code_mem;
+    }
+    s_out = cobs_decode(u8p_in, s_in_size, vp_out, s_out_size);
+    if (s_pos == (s_in_size - 1U))
+    {
+        /* Last code byte points at the frame end, not reduced. */
+        return s_out;
+    }
+    /* The last block is cut short by the frame end, its code byte is the
+       last data byte. */
+    s_size -= (size_t)u8_in_code_mem - 1U;
+    s_size += s_in_size - 2U - s_last;
+    if ((s_out != s_size) || (s_out >= s_out_size))
+    {
+        return 0;
+    }
+    ((uint8_t *)vp_out)[s_out] = u8_in_code_mem;
+    return s_out + 1U;
+}
+
+size_t cobs_zpe_encode(const void *vp_in, size_t s_in_size,
+                       uint8_t *u8p_out, size_t s_out_size)
+{
+    assert(vp_in && u8p_out);
+
+    const uint8_t *u8p_in = (const uint8_t *)vp_in;    // Input data pointer
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;    // Input end pointer
+    const uint8_t *u8p_out_end = u8p_out + s_out_size; // Output end pointer
+    uint8_t *u8p_out_code = u8p_out;                   // Code byte pointer
+    cobs_run_t fp_run = cobs_kernel_get()->fp_run;     // Run function
+
+    while (u8p_out_code < u8p_out_end)
+    {
+        size_t s_in_left = (size_t)(u8p_in_end - u8p_in);
+        size_t s_out_left = (size_t)(u8p_out_end - u8p_out_code) - 1U;
+        size_t s_run_max = (s_in_left < COBS_ZPE_RUN_MAX) ? s_in_left : COBS_ZPE_RUN_MAX;
+        size_t s_run_lim = (s_run_max < s_out_left) ? s_run_max : s_out_left;
+        size_t s_run = fp_run(u8p_in, s_run_lim, u8p_out_code + 1);
+        if (s_run < s_run_lim)
+        {
+            u8p_in += s_run + 1U;
+            if ((s_run > COBS_ZPE_PAIR_RUN_MAX) ||
+                ((u8p_in < u8p_in_end) && (*u8p_in != COBS_FRAME_END)))
+            {
+                /* Encode zero. */
+                *u8p_out_code = (uint8_t)(s_run + 1U);
+                u8p_out_code += s_run + 1U;
+                continue;
+            }
+            /* Encode zero pair, the second zero may be the one after the data. */
+            *u8p_out_code = (uint8_t)(COBS_ZPE_PAIR_CODE + s_run);
+            u8p_out_code += s_run + 1U;
+            if (u8p_in < u8p_in_end)
+            {
+                u8p_in++;
+                continue;
+            }
+            if (u8p_out_code == u8p_out_end)
+            {
+                /* No space left for the frame end. */
+                break;
+            }
+            *u8p_out_code = COBS_FRAME_END;
+            return (size_t)(u8p_out_code + 1 - u8p_out);
+        }
+        else if (s_run < s_run_max)
+        {
+            /* Output buffer too small. */
+            break;
+        }
+        else if (s_run < s_in_left)
+        {
+            /* Encode end of block. */
+            *u8p_out_code = (uint8_t)(COBS_ZPE_RUN_MAX + 1U);
+            u8p_out_code += COBS_ZPE_RUN_MAX + 1U;
+            u8p_in += s_run;
+        }
+        else if (s_run < s_out_left)
+        {
+            /* Frame End */
+            *u8p_out_code = (uint8_t)(s_run + 1U);
+            u8p_out_code += s_run + 1U;
+            *u8p_out_code = COBS_FRAME_END;
+            return (size_t)(u8p_out_code + 1 - u8p_out);
+        }
+        else
+        {
+            /* No space left for the frame end. */
+            break;
+        }
+    }
+    return 0;
+}
+
+size_t cobs_zpe_decode(const uint8_t *u8p_in, size_t s_in_size,
+                       void *vp_out, size_t s_out_size)
+{
+    assert(u8p_in && vp_out);
+
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;    // Input end pointer
+    uint8_t *u8p_out = (uint8_t *)vp_out;              // Output data pointer
+    const uint8_t *u8p_out_end = u8p_out + s_out_size; // Output end pointer
+    cobs_run_t fp_run = cobs_kernel_get()->fp_run;     // Run function
+    size_t s_zeros = 0;                                // Zeros of the last block
+
+    while (u8p_in < u8p_in_end)
+    {
+        uint8_t u8_in_code = *u8p_in;
+        size_t s_code_left;
+        size_t s_in_left;
+        size_t s_out_left;
+        size_t s_run_max;
+        size_t s_run;
+
+        u8p_in++;
+        if (u8_in_code == COBS_FRAME_END)
+        {
+            /* Frame End, the last zero is the one after the data. */
+            s_zeros = (s_zeros > 0U) ? s_zeros - 1U : 0U;
+            if ((u8p_in != u8p_in_end) || ((size_t)(u8p_out_end - u8p_out) < s_zeros))
+            {
+                return 0;
+            }
+            memset(u8p_out, 0, s_zeros);
+            return (size_t)(u8p_out + s_zeros - (uint8_t *)vp_out);
+        }
+        if ((size_t)(u8p_out_end - u8p_out) < s_zeros)
+        {
+            /* Output buffer too small. */
+            return 0;
+        }
+        /* Decode zeros of the previous block. */
+        memset(u8p_out, 0, s_zeros);
+        u8p_out += s_zeros;
+        if (u8_in_code < (COBS_ZPE_RUN_MAX + 1U))
+        {
+            s_code_left = (size_t)u8_in_code - 1U;
+            s_zeros = 1U;
+        }
+        else if (u8_in_code == (COBS_ZPE_RUN_MAX + 1U))
+        {
+            s_code_left = COBS_ZPE_RUN_MAX;
+            s_zeros = 0U;
+        }
+        else
+        {
+            s_code_left = (size_t)u8_in_code - COBS_ZPE_PAIR_CODE;
+            s_zeros = 2U;
+        }
+        s_in_left = (size_t)(u8p_in_end - u8p_in);
+        s_out_left = (size_t)(u8p_out_end - u8p_out);
+        s_run_max = (s_code_left < s_in_left) ? s_code_left : s_in_left;
+        s_run = fp_run(u8p_in, (s_run_max < s_out_left) ? s_run_max : s_out_left, u8p_out);
+        u8p_in += s_run;
+        u8p_out += s_run;
+        if (s_run < s_code_left)
+        {
+            if ((s_run < s_in_left) && (*u8p_in == COBS_FRAME_END) && ((u8p_in + 1) == u8p_in_end))
+            {
+                /* Frame end cuts the block short. */
+                return (size_t)(u8p_out - (uint8_t *)vp_out);
+            }
+            /* Missing frame end, or output buffer too small. */
+            return 0;
+        }
+    }
+    /* Input ended without frame end. */
+    return 0;
+}
+
+size_t cobs_encode_delim(const void *vp_in, size_t s_in_size,
+                         uint8_t *u8p_out, size_t s_out_size, uint8_t u8_delim)
+{
+    assert(vp_in && u8p_out);
+
+    const uint8_t *u8p_in = (const uint8_t *)vp_in;    // Input data pointer
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;    // Input end pointer
+    const uint8_t *u8p_out_end = u8p_out + s_out_size; // Output end pointer
+    uint8_t *u8p_out_code = u8p_out;                   // Code byte pointer
+
+    if (u8_delim == COBS_FRAME_END)
+    {
+        return cobs_encode(vp_in, s_in_size, u8p_out, s_out_size);
+    }
+    while (u8p_out_code < u8p_out_end)
+    {
+        size_t s_in_left = (size_t)(u8p_in_end - u8p_in);
+        size_t s_out_left = (size_t)(u8p_out_end - u8p_out_code) - 1U;
+        size_t s_run_max = (s_in_left < COBS_RUN_MAX) ? s_in_left : COBS_RUN_MAX;
+        size_t s_run_lim = (s_run_max < s_out_left) ? s_run_max : s_out_left;
+        size_t s_run = cobs_run_xor(u8p_in, s_run_lim, u8p_out_code + 1,
+                                    COBS_FRAME_END, u8_delim);
+        if (s_run < s_run_lim)
+        {
+            /* Encode zero. */
+            *u8p_out_code = (uint8_t)(s_run + 1U) ^ u8_delim;
+            u8p_out_code += s_run + 1U;
+            u8p_in += s_run + 1U;
+        }
+        else if (s_run < s_run_max)
+        {
+            /* Output buffer too small. */
+            break;
+        }
+        else if (s_run < s_in_left)
+        {
+            /* Encode end of block. */
+            *u8p_out_code = (uint8_t)COBS_BLOCK_SIZE ^ u8_delim;
+            u8p_out_code += COBS_BLOCK_SIZE;
+            u8p_in += s_run;
+        }
+        else if (s_run < s_out_left)
+        {
+            /* Frame End */
+            *u8p_out_code = (uint8_t)(s_run + 1U) ^ u8_delim;
+            u8p_out_code += s_run + 1U;
+            *u8p_out_code = u8_delim;
+            return (size_t)(u8p_out_code + 1 - u8p_out);
+        }
+        else
+        {
+            /* No space left for the frame end. */
+            break;
+        }
+    }
+    return 0;
+}
+
+size_t cobs_decode_delim(const uint8_t *u8p_in, size_t s_in_size,
+                         void *vp_out, size_t s_out_size, uint8_t u8_delim)
+{
+    assert(u8p_in && vp_out);
+
+    uint8_t *u8p_out = (uint8_t *)vp_out;              // Output data pointer
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;    // Input end pointer
+    const uint8_t *u8p_out_end = u8p_out + s_out_size; // Output end pointer
+    uint8_t u8_in_code_mem;                            // Last code
+    size_t s_code_left;                                // Run length to next code
+
+    if (u8_delim == COBS_FRAME_END)
+    {
+        return cobs_decode(u8p_in, s_in_size, vp_out, s_out_size);
+    }
+    if (s_in_size == 0U)
+    {
+        return 0;
+    }
+    u8_in_code_mem = *u8p_in ^ u8_delim;
+    /* A leading delimiter never matches a code byte, the rest is copied as is. */
+    s_code_left = (u8_in_code_mem != COBS_FRAME_END) ? (size_t)u8_in_code_mem - 1U : s_in_size;
+    u8p_in++;
+
+    for (;;)
+    {
+        size_t s_in_left = (size_t)(u8p_in_end - u8p_in);
+        size_t s_out_left = (size_t)(u8p_out_end - u8p_out);
+        size_t s_run_max = (s_code_left < s_in_left) ? s_code_left : s_in_left;
+        size_t s_run_lim = (s_run_max < s_out_left) ? s_run_max : s_out_left;
+        size_t s_run = cobs_run_xor(u8p_in, s_run_lim, u8p_out, u8_delim, u8_delim);
+        u8p_in += s_run;
+        u8p_out += s_run;
+        if (s_run == s_in_left)
+        {
+            /* Input ended without frame end. */
+            break;
+        }
+        if (*u8p_in == u8_delim)
+        {
+            /* Frame End */
+            u8p_in++;
+            u8_in_code_mem = COBS_FRAME_END;
+            break;
+        }
+        if ((s_run < s_run_max) || (u8p_out == u8p_out_end))
+        {
+            /* Output buffer too small. */
+            return 0;
+        }
+        /* Decode code byte. */
+        if (u8_in_code_mem != COBS_BLOCK_SIZE)
+        {
+            /* Decode zero byte. */
+            *u8p_out = 0;
+            u8p_out++;
+        }
+        u8_in_code_mem = *u8p_in ^ u8_delim;
+        s_code_left = (size_t)u8_in_code_mem - 1U;
+        u8p_in++;
+    }
+    if ((u8p_in == u8p_in_end) && (u8_in_code_mem == COBS_FRAME_END))
+    {
+        /* Verify that all data was decoded and the last byte was the delimiter */
+        return (size_t)(u8p_out - (uint8_t *)vp_out);
+    }
+    return 0;
+}
+
+size_t cobs_encoded_size(const void *vp_in, size_t s_in_size)
+{
+    assert(vp_in);
+
+    return cobs_kernel_get()->fp_encoded_size(vp_in, s_in_size);
+}
+
+void cobs_encoder_begin(cobs_encoder_t *sp_enc, uint8_t *u8p_out, size_t s_out_size)
+{
+    assert(sp_enc && u8p_out);
+
+    sp_enc->u8p_out_start = u8p_out;
+    sp_enc->u8p_out_end = u8p_out + s_out_size;
+    sp_enc->u8p_out_code = u8p_out;
+    sp_enc->u8p_out = u8p_out + 1;
+    sp_enc->i_error = (s_out_size == 0U);
+}
+
+size_t cobs_encoder_update(cobs_encoder_t *sp_enc, const void *vp_in, size_t s_in_size)
+{
+    assert(sp_enc && vp_in);
+
+    const uint8_t *u8p_in = (const uint8_t *)vp_in;   // Input data pointer
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;   // Input end pointer
+    uint8_t *u8p_out = sp_enc->u8p_out;               // Output data pointer
+    uint8_t *u8p_out_code = sp_enc->u8p_out_code;     // Code byte pointer
+    const uint8_t *u8p_out_end = sp_enc->u8p_out_end; // Output end pointer
+    cobs_run_t fp_run = cobs_kernel_get()->fp_run;    // Run function
+
+    while ((u8p_in < u8p_in_end) && !sp_enc->i_error)
+    {
+        size_t s_block = (size_t)(u8p_out - u8p_out_code) - 1U;
+        if (s_block == COBS_RUN_MAX)
+        {
+            /* Encode end of block, only once more data follows. */
+            if (u8p_out >= u8p_out_end)
+            {
+                sp_enc->i_error = 1;
+                break;
+            }
+            *u8p_out_code = COBS_BLOCK_SIZE;
+            u8p_out_code = u8p_out;
+            u8p_out++;
+            s_block = 0;
+        }
+        size_t s_in_left = (size_t)(u8p_in_end - u8p_in);
+        size_t s_out_left = (size_t)(u8p_out_end - u8p_out);
+        size_t s_run_max = (s_in_left < (COBS_RUN_MAX - s_block)) ? s_in_left : (COBS_RUN_MAX - s_block);
+        size_t s_run_lim = (s_run_max < s_out_left) ? s_run_max : s_out_left;
+        size_t s_run = fp_run(u8p_in, s_run_lim, u8p_out);
+        u8p_in += s_run;
+        u8p_out += s_run;
+        if (s_run < s_run_lim)
+        {
+            /* Encode zero. */
+            *u8p_out_code = (uint8_t)(u8p_out - u8p_out_code);
+            u8p_out_code = u8p_out;
+            u8p_out++;
+            u8p_in++;
+        }
+        else if (s_run < s_run_max)
+        {
+            /* Output buffer too small. */
+            sp_enc->i_error = 1;
+        }
+    }
+    sp_enc->u8p_out = u8p_out;
+    sp_enc->u8p_out_code = u8p_out_code;
+    return (size_t)(u8p_in - (const uint8_t *)vp_in);
+}
+
+size_t cobs_encoder_finish(cobs_encoder_t *sp_enc)
+{
+    assert(sp_enc);
+
+    if (sp_enc->i_error || (sp_enc->u8p_out >= sp_enc->u8p_out_end))
+    {
+        return 0;
+    }
+    /* Frame End */
+    *sp_enc->u8p_out_code = (uint8_t)(sp_enc->u8p_out - sp_enc->u8p_out_code);
+    sp_enc->u8p_out_code = sp_enc->u8p_out;
+    *sp_enc->u8p_out = COBS_FRAME_END;
+    sp_enc->u8p_out++;
+    return (size_t)(sp_enc->u8p_out - sp_enc->u8p_out_start);
+}
+
+void cobs_decoder_init(cobs_decoder_t *sp_dec, uint8_t *u8p_buf, size_t s_buf_size,
+                       cobs_frame_cb_t fp_frame, void *vp_ctx)
+{
+    assert(sp_dec && u8p_buf && fp_frame);
+
+    sp_dec->u8p_out_start = u8p_buf;
+    sp_dec->u8p_out_end = u8p_buf + s_buf_size;
+    sp_dec->u8p_out = u8p_buf;
+    sp_dec->s_code_left = 0;
+    sp_dec->u8_in_code_mem = COBS_FRAME_END;
+    sp_dec->i_error = 0;
+    sp_dec->fp_frame = fp_frame;
+    sp_dec->vp_ctx = vp_ctx;
+    sp_dec->s_frames_dropped = 0;
+}
+
+size_t cobs_decoder_update(cobs_decoder_t *sp_dec, const uint8_t *u8p_in, size_t s_in_size)
+{
+    assert(sp_dec && u8p_in);
+
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;   // Input end pointer
+    uint8_t *u8p_out = sp_dec->u8p_out;               // Output data pointer
+    const uint8_t *u8p_out_end = sp_dec->u8p_out_end; // Output end pointer
+    const cobs_kernel_t *sp_kernel = cobs_kernel_get(); // Run and scan functions
+    size_t s_frames = 0;                              // Frames completed
+
+    while (u8p_in < u8p_in_end)
+    {
+        if (sp_dec->i_error)
+        {
+            /* Skip the rest of an oversized frame. */
+            u8p_in += sp_kernel->fp_scan(u8p_in, (size_t)(u8p_in_end - u8p_in));
+            if (u8p_in == u8p_in_end)
+            {
+                break;
+            }
+            u8p_in++;
+            u8p_out = sp_dec->u8p_out_start;
+            sp_dec->u8_in_code_mem = COBS_FRAME_END;
+            sp_dec->i_error = 0;
+            sp_dec->s_frames_dropped++;
+            continue;
+        }
+        if (sp_dec->u8_in_code_mem == COBS_FRAME_END)
+        {
+            /* First code byte, a lone frame end carries no frame. */
+            sp_dec->u8_in_code_mem = *u8p_in;
+            sp_dec->s_code_left = (size_t)*u8p_in - 1U;
+            u8p_in++;
+            continue;
+        }
+        size_t s_in_left = (size_t)(u8p_in_end - u8p_in);
+        size_t s_out_left = (size_t)(u8p_out_end - u8p_out);
+        size_t s_run_max = (sp_dec->s_code_left < s_in_left) ? sp_dec->s_code_left : s_in_left;
+        size_t s_run_lim = (s_run_max < s_out_left) ? s_run_max : s_out_left;
+        size_t s_run = sp_kernel->fp_run(u8p_in, s_run_lim, u8p_out);
+        u8p_in += s_run;
+        u8p_out += s_run;
+        sp_dec->s_code_left -= s_run;
+        if (s_run == s_in_left)
+        {
+            /* Chunk ends inside the frame. */
+            break;
+        }
+        if (*u8p_in == COBS_FRAME_END)
+        {
+            /* Frame End */
+            u8p_in++;
+            sp_dec->fp_frame(sp_dec->vp_ctx, sp_dec->u8p_out_start,
+                             (size_t)(u8p_out - sp_dec->u8p_out_start));
+            u8p_out = sp_dec->u8p_out_start;
+            sp_dec->u8_in_code_mem = COBS_FRAME_END;
+            s_frames++;
+        }
+        else if ((s_run < s_run_max) || (u8p_out == u8p_out_end))
+        {
+            /* Frame does not fit the buffer. */
+            sp_dec->i_error = 1;
+        }
+        else
+        {
+            /* Decode code byte. */
+            if (sp_dec->u8_in_code_mem != COBS_BLOCK_SIZE)
+            {
+                /* Decode zero byte. */
+                *u8p_out = 0;
+                u8p_out++;
+            }
+            sp_dec->u8_in_code_mem = *u8p_in;
+            sp_dec->s_code_left = (size_t)*u8p_in - 1U;
+            u8p_in++;
+        }
+    }
+    sp_dec->u8p_out = u8p_out;
+    return s_frames;
+}
+
+size_t cobs_decode_many(const uint8_t *u8p_in, size_t s_in_size,
+                        void *vp_out, size_t s_out_size,
+                        cobs_frame_t *sp_frames, size_t s_frames_max,
+                        size_t *sp_in_used)
+{
+    assert(u8p_in && vp_out && sp_frames);
+
+    const cobs_kernel_t *sp_kernel = cobs_kernel_get(); // Selected kernel
+    uint8_t *u8p_out = (uint8_t *)vp_out;               // Output data pointer
+    size_t s_in_pos = 0;                                // Input position
+    size_t s_out_pos = 0;                               // Output position
+    size_t s_frames = 0;                                // Frames found
+
+    while (s_frames < s_frames_max)
+    {
+        /* Find the next frame end. */
+        size_t s_frame_size = sp_kernel->fp_scan(u8p_in + s_in_pos, s_in_size - s_in_pos) + 1U;
+        if ((s_in_pos + s_frame_size) > s_in_size)
+        {
+            /* Incomplete frame, left for the next call. */
+            break;
+        }
+        if (s_frame_size == 1U)
+        {
+            /* A lone frame end carries no frame. */
+            s_in_pos++;
+            continue;
+        }
+        size_t s_size = sp_kernel->fp_decode(u8p_in + s_in_pos, s_frame_size,
+                                             u8p_out + s_out_pos, s_out_size - s_out_pos);
+        if ((s_size == 0U) && (s_frame_size > 2U))
+        {
+            /* A terminated frame only fails for lack of output space, the
+               rest is left for the next call. Longer frames never decode
+               to nothing. */
+            break;
+        }
+        sp_frames[s_frames].s_offset = s_out_pos;
+        sp_frames[s_frames].s_size = s_size;
+        sp_frames[s_frames].i_status = COBS_FRAME_OK;
+        s_out_pos += s_size;
+        s_in_pos += s_frame_size;
+        s_frames++;
+    }
+    if (sp_in_used != NULL)
+    {
+        *sp_in_used = s_in_pos;
+    }
+    return s_frames;
+}
+
+size_t cobs_decoded_size(const uint8_t *u8p_in, size_t s_in_size)
+{
+    assert(u8p_in);
+
+    size_t s_pos = 0;                         // Code byte position
+    size_t s_size = 0;                        // Decoded size
+    uint8_t u8_in_code_mem = COBS_BLOCK_SIZE; // Last code
+
+    if ((s_in_size < 2U) || (u8p_in[s_in_size - 1U] != COBS_FRAME_END))
+    {
+        /* No frame end. */
+        return COBS_SIZE_INVALID;
+    }
+    while (s_pos < (s_in_size - 1U))
+    {
+        if (u8p_in[s_pos] == COBS_FRAME_END)
+        {
+            /* Frame end where a code byte is expected. */
+            return COBS_SIZE_INVALID;
+        }
+        if (u8_in_code_mem != COBS_BLOCK_SIZE)
+        {
+            /* Zero byte of the previous block. */
+            s_size++;
+        }
+        u8_in_code_mem = u8p_in[s_pos];
+        s_size += (size_t)u8_in_code_mem - 1U;
+        s_pos += u8_in_code_mem;
+    }
+    /* The last code byte must point at the frame end. */
+    return (s_pos == (s_in_size - 1U)) ? s_size : COBS_SIZE_INVALID;
+}
+
+int cobs_view_init(cobs_view_t *sp_view, const uint8_t *u8p_in, size_t s_in_size)
+{
+    assert(sp_view && u8p_in);
+
+    sp_view->u8p_code = u8p_in;
+    sp_view->u8p_code_end = u8p_in;
+    sp_view->s_size = 0;
+    if ((s_in_size < 2U) || (cobs_kernel_get()->fp_scan(u8p_in, s_in_size) != (s_in_size - 1U)))
+    {
+        /* No frame end, or a zero in front of it. */
+        return 0;
+    }
+    sp_view->s_size = cobs_decoded_size(u8p_in, s_in_size);
+    if (sp_view->s_size == COBS_SIZE_INVALID)
+    {
+        /* Code bytes do not chain up to the frame end. */
+        sp_view->s_size = 0;
+        return 0;
+    }
+    sp_view->u8p_code_end = u8p_in + s_in_size - 1U;
+    return 1;
+}
+
+int cobs_view_next(cobs_view_t *sp_view, cobs_segment_t *sp_seg)
+{
+    assert(sp_view && sp_seg);
+
+    const uint8_t *u8p_code = sp_view->u8p_code; // Code byte pointer
+
+    if (u8p_code >= sp_view->u8p_code_end)
+    {
+        return 0;
+    }
+    sp_seg->u8p_data = u8p_code + 1;
+    sp_seg->s_size = (size_t)*u8p_code - 1U;
+    sp_view->u8p_code = u8p_code + *u8p_code;
+    /* Full blocks and the last block have no zero behind them. */
+    sp_seg->i_zero = (*u8p_code != COBS_BLOCK_SIZE) && (sp_view->u8p_code < sp_view->u8p_code_end);
+    return 1;
 }
 
 /*
@@ -11,15 +11,90 @@
 /*==============================================================================
  INCLUDES
  =============================================================================*/
+#include <stddef.h>
 #include <stdint.h>
 
 /*==============================================================================
  DEFINES
  =============================================================================*/
 #define COBS_ENCODE_OUT_SIZE_MIN(IN_SIZE) \
-    (((IN_SIZE) == 0U) ? 2U : (IN_SIZE) + 2U + (IN_SIZE) / 256U)
+    (((IN_SIZE) == 0U) ? 2U : (IN_SIZE) + 2U + (IN_SIZE) / 254U)
 #define COBS_DECODE_OUT_SIZE_MIN(IN_SIZE) \
     (((IN_SIZE) < 3U) ? 0u : (IN_SIZE)-2U)
+#define COBS_R_DECODE_OUT_SIZE_MIN(IN_SIZE) \
+    (((IN_SIZE) < 2U) ? 0u : (IN_SIZE)-1U)
+#define COBS_ZPE_ENCODE_OUT_SIZE_MIN(IN_SIZE) \
+    ((IN_SIZE) + 2U + (IN_SIZE) / 223U)
+#define COBS_ZPE_DECODE_OUT_SIZE_MIN(IN_SIZE) \
+    (((IN_SIZE) < 2U) ? 0u : 2U * (IN_SIZE)-3U)
+#define COBS_ENCODE_HEADROOM(IN_SIZE) \
+    (1U + (IN_SIZE) / 254U)
+
+#define COBS_FRAME_OK (0)
+#define COBS_FRAME_INVALID (1)
+#define COBS_SIZE_INVALID (SIZE_MAX)
+
+/*==============================================================================
+ PUBLIC TYPES
+ =============================================================================*/
+
+/** Input segment, same layout as POSIX struct iovec. */
+typedef struct
+{
+    void *vp_base; // Segment data pointer
+    size_t s_len;  // Segment size
+} cobs_iovec_t;
+
+/** Incremental encoder state, see cobs_encoder_begin(). */
+typedef struct
+{
+    uint8_t *u8p_out;             // Output data pointer
+    uint8_t *u8p_out_code;        // Code byte pointer
+    uint8_t *u8p_out_start;       // Output start pointer
+    const uint8_t *u8p_out_end;   // Output end pointer
+    int i_error;                  // Set once the output overflowed
+} cobs_encoder_t;
+
+/** Frame descriptor filled by cobs_decode_many(). */
+typedef struct
+{
+    size_t s_offset; // Offset of the decoded frame in the output buffer
+    size_t s_size;   // Decoded size
+    int i_status;    // COBS_FRAME_OK or COBS_FRAME_INVALID
+} cobs_frame_t;
+
+/** Decode view of a frame, see cobs_view_init(). */
+typedef struct
+{
+    const uint8_t *u8p_code;     // Next code byte
+    const uint8_t *u8p_code_end; // Frame end pointer
+    size_t s_size;               // Decoded size
+} cobs_view_t;
+
+/** Payload segment inside an encoded frame, see cobs_view_next(). */
+typedef struct
+{
+    const uint8_t *u8p_data; // Segment data pointer, into the encoded frame
+    size_t s_size;           // Segment size
+    int i_zero;              // Non-zero if a zero byte follows the segment
+} cobs_segment_t;
+
+/** Called by the incremental decoder for every complete frame. */
+typedef void (*cobs_frame_cb_t)(void *vp_ctx, const uint8_t *u8p_frame, size_t s_size);
+
+/** Incremental decoder state, see cobs_decoder_init(). */
+typedef struct
+{
+    uint8_t *u8p_out;             // Output data pointer
+    uint8_t *u8p_out_start;       // Frame buffer start pointer
+    const uint8_t *u8p_out_end;   // Frame buffer end pointer
+    size_t s_code_left;           // Run length to next code
+    uint8_t u8_in_code_mem;       // Last code, zero between frames
+    int i_error;                  // Set while skipping an oversized frame
+    cobs_frame_cb_t fp_frame;     // Frame callback
+    void *vp_ctx;                 // Frame callback context
+    size_t s_frames_dropped;      // Number of oversized frames skipped
+} cobs_decoder_t;
 
 /*==============================================================================
  PUBLIC FUNCTIONS
@@ -37,6 +112,59 @@
 size_t cobs_encode(const void *vp_in, size_t s_in_size,
                    uint8_t *u8p_out, size_t s_out_size);
 
+/**
+ * @brief Reserve space for a payload to be COBS encoded in place
+ * @param u8p_buf Pointer to the output buffer
+ * @param s_buf_size Size of the output buffer
+ * @param s_payload_max Maximum payload size
+ * @return Pointer to write the payload to, NULL if the buffer is too small
+ * @note The payload starts COBS_ENCODE_HEADROOM(s_payload_max) bytes into
+ * the buffer, the buffer needs COBS_ENCODE_OUT_SIZE_MIN(s_payload_max) bytes.
+ * Encode it with cobs_encode_commit().
+ */
+uint8_t *cobs_encode_reserve(uint8_t *u8p_buf, size_t s_buf_size, size_t s_payload_max);
+
+/**
+ * @brief COBS encode a reserved payload in place
+ * @param u8p_buf Pointer to the output buffer passed to cobs_encode_reserve()
+ * @param s_buf_size Size of the output buffer
+ * @param s_payload_max Maximum payload size passed to cobs_encode_reserve()
+ * @param s_payload_size Size of the payload written
+ * @return Encoded buffer size in bytes, the frame starts at u8p_buf
+ * @note Returns zero if the payload exceeds s_payload_max or does not fit.
+ */
+size_t cobs_encode_commit(uint8_t *u8p_buf, size_t s_buf_size,
+                          size_t s_payload_max, size_t s_payload_size);
+
+/**
+ * @brief COBS encode several frames to one buffer
+ * @param sp_in Pointer to the input frames
+ * @param s_count Number of input frames
+ * @param u8p_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @param sp_offsets Pointer to s_count frame offsets in the output, may be NULL
+ * @return Encoded buffer size in bytes
+ * @note Each frame is written with its frame end, back to back. The output
+ * must hold the sum of COBS_ENCODE_OUT_SIZE_MIN() over the frame sizes, this
+ * is checked once up front. Returns zero without writing anything otherwise.
+ */
+size_t cobs_encode_many(const cobs_iovec_t *sp_in, size_t s_count,
+                        uint8_t *u8p_out, size_t s_out_size,
+                        size_t *sp_offsets);
+
+/**
+ * @brief COBS encode a payload split over several segments
+ * @param sp_in Pointer to the payload segments
+ * @param s_count Number of payload segments
+ * @param u8p_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @return Encoded buffer size in bytes
+ * @note Encodes one frame as if the segments were concatenated, code blocks
+ * span segment boundaries. Returns zero if not all data was encoded.
+ */
+size_t cobs_encodev(const cobs_iovec_t *sp_in, size_t s_count,
+                    uint8_t *u8p_out, size_t s_out_size);
+
 /**
  * @brief COBS decode data from buffer
  * @param u8p_in Pointer to encoded input bytes
@@ -44,11 +172,259 @@ size_t cobs_encode(const void *vp_in, size_t s_in_size,
  * @param vp_out Pointer to encoded output buffer
  * @param s_out_size Size of output data
  * @return Number of bytes successfully decoded
- * @note Returns zero if not all data was decoded.
+ * @note Returns zero if not all data was decoded. The output may overlap the
+ * input as long as it does not start after it.
  */
 size_t cobs_decode(const uint8_t *u8p_in, size_t s_in_size,
                    void *vp_out, size_t s_out_size);
 
+/**
+ * @brief COBS decode data in place
+ * @param u8p_buf Pointer to encoded bytes, overwritten with the decoded data
+ * @param s_size Size of encoded data
+ * @return Number of bytes successfully decoded
+ * @note Decoding never grows the data, the decoded bytes start at u8p_buf.
+ * Returns zero if not all data was decoded, the buffer is clobbered then.
+ */
+size_t cobs_decode_inplace(uint8_t *u8p_buf, size_t s_size);
+
+/**
+ * @brief COBS decode data into several buffers
+ * @param u8p_in Pointer to encoded input bytes
+ * @param s_in_size Size of input data
+ * @param sp_out Pointer to the output segments, filled in order
+ * @param s_count Number of output segments
+ * @return Number of bytes successfully decoded
+ * @note Decodes as cobs_decode() into the concatenated segments. Stops at
+ * first frame end. Returns zero if the segments are too small.
+ */
+size_t cobs_decodev(const uint8_t *u8p_in, size_t s_in_size,
+                    const cobs_iovec_t *sp_out, size_t s_count);
+
+/**
+ * @brief COBS/R (reduced) encode data into buffer
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @param u8p_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @return Encoded buffer size in bytes
+ * @note Encodes as cobs_encode(), then replaces the last code byte with the
+ * last data byte if that byte is not smaller than the code. The frame is
+ * one byte shorter then. Same output size contract as cobs_encode().
+ */
+size_t cobs_r_encode(const void *vp_in, size_t s_in_size,
+                     uint8_t *u8p_out, size_t s_out_size);
+
+/**
+ * @brief COBS/R (reduced) decode data from buffer
+ * @param u8p_in Pointer to encoded input bytes
+ * @param s_in_size Size of input data
+ * @param vp_out Pointer to decoded output buffer
+ * @param s_out_size Size of output data, see COBS_R_DECODE_OUT_SIZE_MIN()
+ * @return Number of bytes successfully decoded
+ * @note Decodes plain COBS frames as cobs_decode(). A reduced frame decodes
+ * to one byte more than its size suggests, the last code byte is appended
+ * as the last data byte.
+ */
+size_t cobs_r_decode(const uint8_t *u8p_in, size_t s_in_size,
+                     void *vp_out, size_t s_out_size);
+
+/**
+ * @brief COBS/ZPE (zero pair elimination) encode data into buffer
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @param u8p_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data, see COBS_ZPE_ENCODE_OUT_SIZE_MIN()
+ * @return Encoded buffer size in bytes
+ * @note Code bytes 0x01 to 0xDF are followed by code - 1 data bytes and a
+ * zero, 0xE0 by 223 data bytes and no zero, 0xE1 to 0xFF by code - 0xE1
+ * data bytes and two zeros. Returns zero if not all data was encoded.
+ */
+size_t cobs_zpe_encode(const void *vp_in, size_t s_in_size,
+                       uint8_t *u8p_out, size_t s_out_size);
+
+/**
+ * @brief COBS/ZPE (zero pair elimination) decode data from buffer
+ * @param u8p_in Pointer to encoded input bytes
+ * @param s_in_size Size of input data
+ * @param vp_out Pointer to decoded output buffer
+ * @param s_out_size Size of output data, see COBS_ZPE_DECODE_OUT_SIZE_MIN()
+ * @return Number of bytes successfully decoded
+ * @note Returns zero if not all data was decoded. A zero pair code byte
+ * decodes to more than one byte, the output may not overlap the input.
+ */
+size_t cobs_zpe_decode(const uint8_t *u8p_in, size_t s_in_size,
+                       void *vp_out, size_t s_out_size);
+
+/**
+ * @brief COBS encode data to buffer with a custom frame delimiter
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @param u8p_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @param u8_delim Frame delimiter byte
+ * @return Encoded buffer size in bytes
+ * @note Same as cobs_encode() followed by XORing every output byte with
+ * u8_delim, but in one pass. The frame ends with u8_delim, no other byte
+ * equals it. Returns zero if not all data was encoded.
+ */
+size_t cobs_encode_delim(const void *vp_in, size_t s_in_size,
+                         uint8_t *u8p_out, size_t s_out_size, uint8_t u8_delim);
+
+/**
+ * @brief COBS decode data from buffer with a custom frame delimiter
+ * @param u8p_in Pointer to encoded input bytes
+ * @param s_in_size Size of input data
+ * @param vp_out Pointer to decoded output buffer
+ * @param s_out_size Size of output data
+ * @param u8_delim Frame delimiter byte
+ * @return Number of bytes successfully decoded
+ * @note Reverses cobs_encode_delim() in one pass, returns the same as
+ * cobs_decode() on the XORed input.
+ */
+size_t cobs_decode_delim(const uint8_t *u8p_in, size_t s_in_size,
+                         void *vp_out, size_t s_out_size, uint8_t u8_delim);
+
+/**
+ * @brief Exact COBS encoded size of data
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @return Size cobs_encode() writes for this data, including the frame end
+ * @note Nothing is written. The result never exceeds
+ * COBS_ENCODE_OUT_SIZE_MIN(s_in_size).
+ */
+size_t cobs_encoded_size(const void *vp_in, size_t s_in_size);
+
+/**
+ * @brief Start an incremental COBS encode
+ * @param sp_enc Pointer to encoder state
+ * @param u8p_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @note Feed the payload with cobs_encoder_update() and close the frame with
+ * cobs_encoder_finish(). The output equals cobs_encode() of the whole
+ * payload, blocks may span chunks.
+ */
+void cobs_encoder_begin(cobs_encoder_t *sp_enc, uint8_t *u8p_out, size_t s_out_size);
+
+/**
+ * @brief COBS encode the next chunk of the payload
+ * @param sp_enc Pointer to encoder state
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @return Number of input bytes encoded
+ * @note Returns less than s_in_size if the output buffer is full, the frame
+ * is then lost and cobs_encoder_finish() returns zero.
+ */
+size_t cobs_encoder_update(cobs_encoder_t *sp_enc, const void *vp_in, size_t s_in_size);
+
+/**
+ * @brief Finish an incremental COBS encode
+ * @param sp_enc Pointer to encoder state
+ * @return Encoded buffer size in bytes
+ * @note Returns zero if not all data was encoded.
+ */
+size_t cobs_encoder_finish(cobs_encoder_t *sp_enc);
+
+/**
+ * @brief Set up an incremental COBS decoder
+ * @param sp_dec Pointer to decoder state
+ * @param u8p_buf Pointer to the frame buffer
+ * @param s_buf_size Size of the frame buffer, i.e. the maximum frame size
+ * @param fp_frame Callback for every decoded frame
+ * @param vp_ctx Context passed to the callback
+ */
+void cobs_decoder_init(cobs_decoder_t *sp_dec, uint8_t *u8p_buf, size_t s_buf_size,
+                       cobs_frame_cb_t fp_frame, void *vp_ctx);
+
+/**
+ * @brief COBS decode the next chunk of a byte stream
+ * @param sp_dec Pointer to decoder state
+ * @param u8p_in Pointer to encoded input bytes
+ * @param s_in_size Size of input data
+ * @return Number of frames completed by this chunk
+ * @note Chunks may split frames anywhere. Frames are decoded straight into
+ * the frame buffer and passed to the callback at their frame end, the data
+ * is valid until the callback returns. Frames that do not fit the buffer
+ * are skipped and counted in s_frames_dropped. A lone frame end carries no
+ * frame and is ignored.
+ */
+size_t cobs_decoder_update(cobs_decoder_t *sp_dec, const uint8_t *u8p_in, size_t s_in_size);
+
+/**
+ * @brief COBS decode all frames of a buffer
+ * @param u8p_in Pointer to encoded input bytes, several frames
+ * @param s_in_size Size of input data
+ * @param vp_out Pointer to the output buffer all frames are decoded into
+ * @param s_out_size Size of output data
+ * @param sp_frames Pointer to the frame descriptors to fill
+ * @param s_frames_max Number of frame descriptors
+ * @param sp_in_used Pointer to the number of input bytes used, may be NULL
+ * @return Number of frame descriptors filled
+ * @note Frame ends are found with the kernel scan, the frames are decoded
+ * back to back into the output buffer. Lone frame ends are skipped. Every
+ * frame decodes as with cobs_decode() and the streaming decoders, a code
+ * byte pointing past the frame end cuts the frame short there, so the
+ * status is always COBS_FRAME_OK. Decoding stops at an incomplete last
+ * frame, when the descriptors run out or when the next frame does not fit
+ * the output; the input from *sp_in_used on is left for the next call. An
+ * output of COBS_DECODE_OUT_SIZE_MIN(s_in_size) bytes always suffices.
+ */
+size_t cobs_decode_many(const uint8_t *u8p_in, size_t s_in_size,
+                        void *vp_out, size_t s_out_size,
+                        cobs_frame_t *sp_frames, size_t s_frames_max,
+                        size_t *sp_in_used);
+
+/**
+ * @brief COBS decoded size of a frame
+ * @param u8p_in Pointer to encoded input bytes
+ * @param s_in_size Size of input data, including the frame end
+ * @return Number of bytes cobs_decode() produces for this frame, or
+ * COBS_SIZE_INVALID
+ * @note Only follows the code bytes, O(n/254) for typical data. Returns
+ * COBS_SIZE_INVALID if the chain does not end exactly on the frame end, the
+ * empty frame 01 00 has size zero. Zeros inside a run are not detected,
+ * cobs_decode() still rejects them.
+ */
+size_t cobs_decoded_size(const uint8_t *u8p_in, size_t s_in_size);
+
+/**
+ * @brief Validate a frame for zero-copy reading
+ * @param sp_view Pointer to the view to set up
+ * @param u8p_in Pointer to encoded input bytes, must stay valid
+ * @param s_in_size Size of input data, including the frame end
+ * @return Non-zero if the frame is valid, the decoded size is in s_size
+ * @note A frame is valid if its only zero is the frame end and its code
+ * bytes chain up to it. Walk the payload with cobs_view_next().
+ */
+int cobs_view_init(cobs_view_t *sp_view, const uint8_t *u8p_in, size_t s_in_size);
+
+/**
+ * @brief Next payload segment of a frame view
+ * @param sp_view Pointer to the view
+ * @param sp_seg Pointer to the segment to fill
+ * @return Non-zero if a segment was returned, zero at the end of the frame
+ * @note The segments point into the encoded frame. The decoded payload is
+ * each segment followed by a zero byte where i_zero is set.
+ */
+int cobs_view_next(cobs_view_t *sp_view, cobs_segment_t *sp_seg);
+
+/**
+ * @brief Name of the encode/decode kernel in use
+ * @return Kernel name: "avx512bw", "avx2", "sse2", "swar" or "scalar"
+ * @note The best kernel for the CPU is selected at load time. The COBS_KERNEL
+ * environment variable forces a kernel by name if the CPU supports it.
+ */
+const char *cobs_kernel_name(void);
+
+/**
+ * @brief Select the encode/decode kernel
+ * @param cp_name Kernel name, or NULL for the best kernel for the CPU
+ * @return Non-zero if the kernel was selected
+ * @note Returns zero and keeps the current kernel if the name is unknown or
+ * the CPU does not support it. Not thread safe against concurrent calls.
+ */
+int cobs_kernel_set(const char *cp_name);
+
 #endif /* COBS_H */
 
 /*
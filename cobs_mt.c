@@ -0,0 +1,840 @@
+/** @file cobs_mt.c
+ *
+ * @author Falk Kyburz
+ * @brief Multi-threaded Consistent Overhead Byte Stuffing
+ *
+ */
+
+/*==============================================================================
+ INCLUDES
+ =============================================================================*/
+#include "cobs_mt.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*==============================================================================
+ PRIVATE DEFINES
+ =============================================================================*/
+#define COBS_BLOCK_SIZE (255U)
+#define COBS_FRAME_END (0U)
+#define COBS_RUN_MAX (COBS_BLOCK_SIZE - 1U)
+
+/*==============================================================================
+ PRIVATE TYPES
+ =============================================================================*/
+
+/** Work of one thread, called with the thread index. */
+typedef void (*cobs_mt_job_t)(void *vp_ctx, unsigned u_index);
+
+/** Thread start argument. */
+typedef struct
+{
+    cobs_mt_job_t fp_job; // Job function
+    void *vp_ctx;         // Job context
+    unsigned u_index;     // Thread index
+} cobs_mt_worker_t;
+
+/** Shared state of a parallel encode. */
+typedef struct
+{
+    const uint8_t *u8p_in;                        // Input data pointer
+    size_t s_in_size;                             // Size of input data
+    uint8_t *u8p_out;                             // Output data pointer
+    unsigned u_chunks;                            // Number of chunks
+    size_t sa_start[COBS_MT_THREADS_MAX + 1U];    // Chunk start in the input
+    size_t sa_block[COBS_MT_THREADS_MAX];         // Block start after the last zero in front of the chunk
+    size_t sa_zero[COBS_MT_THREADS_MAX];          // First zero in the chunk
+    size_t sa_size[COBS_MT_THREADS_MAX];          // Encoded chunk size
+    size_t sa_offset[COBS_MT_THREADS_MAX + 1U];   // Chunk start in the output
+} cobs_mt_encode_t;
+
+/** Shared state of a parallel decode. */
+typedef struct
+{
+    const uint8_t *u8p_in;                        // Input data pointer
+    size_t s_in_size;                             // Size of input data
+    uint8_t *u8p_out;                             // Output data pointer
+    unsigned u_chunks;                            // Number of chunks
+    size_t sa_code[COBS_MT_THREADS_MAX + 1U];     // First code byte of the chunk
+    size_t sa_offset[COBS_MT_THREADS_MAX];        // Chunk start in the output
+    int ia_error[COBS_MT_THREADS_MAX];            // Set if a run holds a zero
+} cobs_mt_decode_t;
+
+/** Frame queued in the decode pool. */
+typedef struct cobs_pool_job
+{
+    struct cobs_pool_job *sp_next;   // Next frame of the source
+    struct cobs_pool_job *sp_task_next; // Next job in the task queue
+    struct cobs_pool_job *sp_task_prev; // Previous job in the task queue
+    unsigned u_source;               // Source index
+    int i_status;                    // Frame status
+    int i_done;                      // Set once decoded
+    size_t s_in_size;                // Encoded size
+    size_t s_size;                   // Decoded size
+    uint8_t *u8p_out;                // Decoded frame
+    uint8_t u8a_in[];                // Encoded frame, followed by the decoded frame
+} cobs_pool_job_t;
+
+/** Task queue of a decode thread. */
+typedef struct
+{
+    pthread_mutex_t s_mutex;       // Protects the queue
+    cobs_pool_job_t *sp_head;      // Oldest job, taken by the owner
+    cobs_pool_job_t *sp_tail;      // Newest job, stolen by other threads
+    pthread_t s_thread;            // Decode thread
+    cobs_pool_t *sp_pool;          // Pool the thread belongs to
+    unsigned u_index;              // Thread index
+} cobs_pool_worker_t;
+
+/** Stream state of a source. */
+typedef struct
+{
+    pthread_mutex_t s_mutex;  // Protects the frame list and delivery
+    cobs_pool_job_t *sp_head; // Oldest frame not delivered yet
+    cobs_pool_job_t *sp_tail; // Newest frame
+    uint8_t *u8p_part;        // Incomplete frame
+    size_t s_part_size;       // Size of the incomplete frame
+    int i_part_drop;          // Set while skipping an oversized frame
+    unsigned u_next_worker;   // Task queue for the next frame
+} cobs_pool_source_t;
+
+struct cobs_pool
+{
+    pthread_mutex_t s_mutex;         // Protects the counters
+    pthread_cond_t s_cond_work;      // Signalled when a job is queued
+    pthread_cond_t s_cond_idle;      // Signalled when all jobs are delivered
+    size_t s_queued;                 // Jobs queued but not taken
+    size_t s_pending;                // Jobs queued but not delivered
+    int i_stop;                      // Set to stop the threads
+    unsigned u_threads;              // Number of decode threads
+    unsigned u_started;              // Number of decode threads running
+    unsigned u_sources;              // Number of sources
+    size_t s_in_max;                 // Maximum encoded frame size
+    cobs_pool_cb_t fp_frame;         // Frame callback
+    void *vp_ctx;                    // Frame callback context
+    cobs_pool_worker_t *sp_workers;  // Decode threads
+    cobs_pool_source_t *sp_sources;  // Sources
+};
+
+/*==============================================================================
+ PRIVATE FUNCTIONS
+ =============================================================================*/
+
+/**
+ * @brief Thread entry, runs the job
+ * @param vp_arg Pointer to the worker
+ * @return NULL
+ */
+static void *cobs_mt_thread(void *vp_arg)
+{
+    cobs_mt_worker_t *sp_worker = (cobs_mt_worker_t *)vp_arg;
+
+    sp_worker->fp_job(sp_worker->vp_ctx, sp_worker->u_index);
+    return NULL;
+}
+
+/**
+ * @brief Run a job on several threads and wait for all of them
+ * @param u_jobs Number of jobs, job 0 runs on the calling thread
+ * @param fp_job Job function
+ * @param vp_ctx Job context
+ * @note Jobs whose thread cannot be created run on the calling thread.
+ */
+static void cobs_mt_run(unsigned u_jobs, cobs_mt_job_t fp_job, void *vp_ctx)
+{
+    pthread_t ta_thread[COBS_MT_THREADS_MAX];     // Threads
+    cobs_mt_worker_t sa_worker[COBS_MT_THREADS_MAX]; // Thread arguments
+    int ia_started[COBS_MT_THREADS_MAX];          // Thread created
+    unsigned i;
+
+    for (i = 1; i < u_jobs; i++)
+    {
+        sa_worker[i].fp_job = fp_job;
+        sa_worker[i].vp_ctx = vp_ctx;
+        sa_worker[i].u_index = i;
+        ia_started[i] = (pthread_create(&ta_thread[i], NULL, cobs_mt_thread, &sa_worker[i]) == 0);
+    }
+    fp_job(vp_ctx, 0);
+    for (i = 1; i < u_jobs; i++)
+    {
+        if (ia_started[i])
+        {
+            (void)pthread_join(ta_thread[i], NULL);
+        }
+        else
+        {
+            fp_job(vp_ctx, i);
+        }
+    }
+}
+
+/**
+ * @brief Find the zeros around a chunk start
+ * @param vp_ctx Pointer to the encode state
+ * @param u_index Chunk index
+ * @note Records the block start after the last zero in the previous chunk,
+ * or zero if there is none, and the first zero in the chunk.
+ */
+static void cobs_mt_encode_split(void *vp_ctx, unsigned u_index)
+{
+    cobs_mt_encode_t *sp_enc = (cobs_mt_encode_t *)vp_ctx;
+    const uint8_t *u8p_in = sp_enc->u8p_in;                 // Input data pointer
+    size_t s_start = sp_enc->sa_start[u_index];             // Chunk start
+    size_t s_end = sp_enc->sa_start[u_index + 1U];          // Chunk end
+    size_t s_prev = (u_index > 0U) ? sp_enc->sa_start[u_index - 1U] : 0U; // Previous chunk start
+    size_t s_pos = s_start;                                 // Input position
+    const uint8_t *u8p_zero;                                // First zero
+
+    while ((s_pos > s_prev) && (u8p_in[s_pos - 1U] != COBS_FRAME_END))
+    {
+        s_pos--;
+    }
+    sp_enc->sa_block[u_index] = s_pos;
+    u8p_zero = (const uint8_t *)memchr(u8p_in + s_start, COBS_FRAME_END, s_end - s_start);
+    sp_enc->sa_zero[u_index] = (u8p_zero != NULL) ? (size_t)(u8p_zero - u8p_in) : s_end;
+}
+
+/**
+ * @brief Compute the encoded size of a chunk
+ * @param vp_ctx Pointer to the encode state
+ * @param u_index Chunk index
+ * @note All but the last chunk end on a block start, their last block is
+ * completed by the next chunk. The frame end and either the empty block
+ * behind a zero or nothing behind a full block are not part of them.
+ */
+static void cobs_mt_encode_size(void *vp_ctx, unsigned u_index)
+{
+    cobs_mt_encode_t *sp_enc = (cobs_mt_encode_t *)vp_ctx;
+    size_t s_start = sp_enc->sa_start[u_index];    // Chunk start
+    size_t s_end = sp_enc->sa_start[u_index + 1U]; // Chunk end
+    size_t s_size = cobs_encoded_size(sp_enc->u8p_in + s_start, s_end - s_start);
+
+    if ((u_index + 1U) < sp_enc->u_chunks)
+    {
+        s_size -= (sp_enc->u8p_in[s_end - 1U] == COBS_FRAME_END) ? 2U : 1U;
+    }
+    sp_enc->sa_size[u_index] = s_size;
+}
+
+/**
+ * @brief Encode a chunk to its output offset
+ * @param vp_ctx Pointer to the encode state
+ * @param u_index Chunk index
+ */
+static void cobs_mt_encode_chunk(void *vp_ctx, unsigned u_index)
+{
+    cobs_mt_encode_t *sp_enc = (cobs_mt_encode_t *)vp_ctx;
+    size_t s_start = sp_enc->sa_start[u_index];                // Chunk start
+    size_t s_end = sp_enc->sa_start[u_index + 1U];             // Chunk end
+    uint8_t *u8p_out = sp_enc->u8p_out + sp_enc->sa_offset[u_index]; // Output data pointer
+    cobs_encoder_t s_enc;                                      // Encoder state
+
+    if ((u_index + 1U) == sp_enc->u_chunks)
+    {
+        (void)cobs_encode(sp_enc->u8p_in + s_start, s_end - s_start, u8p_out, sp_enc->sa_size[u_index]);
+        return;
+    }
+    /* The byte behind the chunk belongs to the next one, the encoder only
+       checks for it but never writes it: the chunk ends on a block start. */
+    cobs_encoder_begin(&s_enc, u8p_out, sp_enc->sa_size[u_index] + 1U);
+    (void)cobs_encoder_update(&s_enc, sp_enc->u8p_in + s_start, s_end - s_start);
+    if ((size_t)(s_enc.u8p_out - s_enc.u8p_out_code) == COBS_BLOCK_SIZE)
+    {
+        /* Encode end of block, the next chunk continues the data. */
+        *s_enc.u8p_out_code = COBS_BLOCK_SIZE;
+    }
+}
+
+/**
+ * @brief Decode the blocks of a chunk to its output offset
+ * @param vp_ctx Pointer to the decode state
+ * @param u_index Chunk index
+ */
+static void cobs_mt_decode_chunk(void *vp_ctx, unsigned u_index)
+{
+    cobs_mt_decode_t *sp_dec = (cobs_mt_decode_t *)vp_ctx;
+    const uint8_t *u8p_in = sp_dec->u8p_in;                      // Input data pointer
+    const uint8_t *u8p_in_end = u8p_in + sp_dec->s_in_size - 1U; // Frame end pointer
+    const uint8_t *u8p_code = u8p_in + sp_dec->sa_code[u_index]; // Code byte pointer
+    const uint8_t *u8p_code_end = u8p_in + sp_dec->sa_code[u_index + 1U]; // Next chunk
+    uint8_t *u8p_out = sp_dec->u8p_out + sp_dec->sa_offset[u_index]; // Output data pointer
+
+    while (u8p_code < u8p_code_end)
+    {
+        uint8_t u8_code = *u8p_code;
+        size_t s_run = (size_t)u8_code - 1U;
+        if (memchr(u8p_code + 1, COBS_FRAME_END, s_run) != NULL)
+        {
+            /* Frame end inside a run. */
+            sp_dec->ia_error[u_index] = 1;
+            return;
+        }
+        memcpy(u8p_out, u8p_code + 1, s_run);
+        u8p_out += s_run;
+        u8p_code += u8_code;
+        if ((u8_code != COBS_BLOCK_SIZE) && (u8p_code < u8p_in_end))
+        {
+            /* Decode zero byte. */
+            *u8p_out = 0;
+            u8p_out++;
+        }
+    }
+}
+
+/**
+ * @brief Take a job from a task queue
+ * @param sp_worker Pointer to the thread owning the queue
+ * @param i_steal Non-zero to take the newest job instead of the oldest
+ * @return Pointer to the job, NULL if the queue is empty
+ */
+static cobs_pool_job_t *cobs_pool_take(cobs_pool_worker_t *sp_worker, int i_steal)
+{
+    cobs_pool_job_t *sp_job; // Job taken
+
+    pthread_mutex_lock(&sp_worker->s_mutex);
+    sp_job = i_steal ? sp_worker->sp_tail : sp_worker->sp_head;
+    if (sp_job != NULL)
+    {
+        if (sp_job->sp_task_prev != NULL)
+        {
+            sp_job->sp_task_prev->sp_task_next = sp_job->sp_task_next;
+        }
+        else
+        {
+            sp_worker->sp_head = sp_job->sp_task_next;
+        }
+        if (sp_job->sp_task_next != NULL)
+        {
+            sp_job->sp_task_next->sp_task_prev = sp_job->sp_task_prev;
+        }
+        else
+        {
+            sp_worker->sp_tail = sp_job->sp_task_prev;
+        }
+    }
+    pthread_mutex_unlock(&sp_worker->s_mutex);
+    return sp_job;
+}
+
+/**
+ * @brief Decode a job and deliver all decoded frames of its source in order
+ * @param sp_pool Pointer to the pool
+ * @param sp_job Pointer to the job
+ */
+static void cobs_pool_decode(cobs_pool_t *sp_pool, cobs_pool_job_t *sp_job)
+{
+    cobs_pool_source_t *sp_source = &sp_pool->sp_sources[sp_job->u_source]; // Source of the job
+    size_t s_delivered = 0;                                              // Frames delivered
+
+    if (sp_job->i_status == COBS_FRAME_OK)
+    {
+        /* Decoded as by cobs_decode_many(), a terminated frame always fits
+           an output of its encoded size. */
+        sp_job->s_size = cobs_decode(sp_job->u8a_in, sp_job->s_in_size, sp_job->u8p_out, sp_job->s_in_size);
+    }
+
+    pthread_mutex_lock(&sp_source->s_mutex);
+    sp_job->i_done = 1;
+    while ((sp_source->sp_head != NULL) && sp_source->sp_head->i_done)
+    {
+        cobs_pool_job_t *sp_head = sp_source->sp_head;
+        sp_source->sp_head = sp_head->sp_next;
+        if (sp_source->sp_head == NULL)
+        {
+            sp_source->sp_tail = NULL;
+        }
+        sp_pool->fp_frame(sp_pool->vp_ctx, sp_head->u_source, sp_head->u8p_out,
+                          sp_head->s_size, sp_head->i_status);
+        free(sp_head);
+        s_delivered++;
+    }
+    pthread_mutex_unlock(&sp_source->s_mutex);
+
+    if (s_delivered > 0U)
+    {
+        pthread_mutex_lock(&sp_pool->s_mutex);
+        sp_pool->s_pending -= s_delivered;
+        if (sp_pool->s_pending == 0U)
+        {
+            pthread_cond_broadcast(&sp_pool->s_cond_idle);
+        }
+        pthread_mutex_unlock(&sp_pool->s_mutex);
+    }
+}
+
+/**
+ * @brief Decode thread, works its own queue first and then steals
+ * @param vp_arg Pointer to the worker
+ * @return NULL
+ */
+static void *cobs_pool_thread(void *vp_arg)
+{
+    cobs_pool_worker_t *sp_worker = (cobs_pool_worker_t *)vp_arg;
+    cobs_pool_t *sp_pool = sp_worker->sp_pool; // Pool of the thread
+
+    for (;;)
+    {
+        cobs_pool_job_t *sp_job = cobs_pool_take(sp_worker, 0);
+        unsigned i;
+
+        for (i = 1; (sp_job == NULL) && (i < sp_pool->u_threads); i++)
+        {
+            sp_job = cobs_pool_take(&sp_pool->sp_workers[(sp_worker->u_index + i) % sp_pool->u_threads], 1);
+        }
+        pthread_mutex_lock(&sp_pool->s_mutex);
+        if (sp_job != NULL)
+        {
+            sp_pool->s_queued--;
+            pthread_mutex_unlock(&sp_pool->s_mutex);
+            cobs_pool_decode(sp_pool, sp_job);
+            continue;
+        }
+        while ((sp_pool->s_queued == 0U) && !sp_pool->i_stop)
+        {
+            pthread_cond_wait(&sp_pool->s_cond_work, &sp_pool->s_mutex);
+        }
+        if ((sp_pool->s_queued == 0U) && sp_pool->i_stop)
+        {
+            pthread_mutex_unlock(&sp_pool->s_mutex);
+            return NULL;
+        }
+        pthread_mutex_unlock(&sp_pool->s_mutex);
+    }
+}
+
+/**
+ * @brief Queue a frame of a source
+ * @param sp_pool Pointer to the pool
+ * @param u_source Source index
+ * @param u8p_tail Pointer to the end of the frame, the rest is buffered
+ * @param s_tail_size Size of the end of the frame, including the frame end
+ * @return Non-zero if the frame was queued
+ */
+static int cobs_pool_queue(cobs_pool_t *sp_pool, unsigned u_source,
+                           const uint8_t *u8p_tail, size_t s_tail_size)
+{
+    cobs_pool_source_t *sp_source = &sp_pool->sp_sources[u_source]; // Source of the frame
+    size_t s_in_size = sp_source->s_part_size + s_tail_size;       // Encoded size
+    int i_status = COBS_FRAME_OK;                                   // Frame status
+    cobs_pool_worker_t *sp_worker;                                  // Task queue
+    cobs_pool_job_t *sp_job;                                        // New job
+
+    if (sp_source->i_part_drop || (s_in_size > sp_pool->s_in_max))
+    {
+        /* Oversized frame, delivered as invalid to keep the order. */
+        i_status = COBS_FRAME_INVALID;
+        s_in_size = 0;
+    }
+    sp_job = (cobs_pool_job_t *)malloc(sizeof(cobs_pool_job_t) + 2U * s_in_size);
+    if (sp_job == NULL)
+    {
+        return 0;
+    }
+    sp_job->sp_next = NULL;
+    sp_job->sp_task_next = NULL;
+    sp_job->u_source = u_source;
+    sp_job->i_status = i_status;
+    sp_job->i_done = 0;
+    sp_job->s_in_size = s_in_size;
+    sp_job->s_size = 0;
+    sp_job->u8p_out = sp_job->u8a_in + s_in_size;
+    if (s_in_size > 0U)
+    {
+        memcpy(sp_job->u8a_in, sp_source->u8p_part, sp_source->s_part_size);
+        memcpy(sp_job->u8a_in + sp_source->s_part_size, u8p_tail, s_tail_size);
+    }
+
+    /* Count the job before a running worker can take and deliver it. */
+    pthread_mutex_lock(&sp_pool->s_mutex);
+    sp_pool->s_queued++;
+    sp_pool->s_pending++;
+    pthread_mutex_unlock(&sp_pool->s_mutex);
+
+    pthread_mutex_lock(&sp_source->s_mutex);
+    if (sp_source->sp_tail != NULL)
+    {
+        sp_source->sp_tail->sp_next = sp_job;
+    }
+    else
+    {
+        sp_source->sp_head = sp_job;
+    }
+    sp_source->sp_tail = sp_job;
+    pthread_mutex_unlock(&sp_source->s_mutex);
+
+    /* Spread the frames of a source over the threads. */
+    sp_worker = &sp_pool->sp_workers[sp_source->u_next_worker];
+    sp_source->u_next_worker = (sp_source->u_next_worker + 1U) % sp_pool->u_threads;
+    pthread_mutex_lock(&sp_worker->s_mutex);
+    sp_job->sp_task_prev = sp_worker->sp_tail;
+    if (sp_worker->sp_tail != NULL)
+    {
+        sp_worker->sp_tail->sp_task_next = sp_job;
+    }
+    else
+    {
+        sp_worker->sp_head = sp_job;
+    }
+    sp_worker->sp_tail = sp_job;
+    pthread_mutex_unlock(&sp_worker->s_mutex);
+
+    pthread_mutex_lock(&sp_pool->s_mutex);
+    pthread_cond_signal(&sp_pool->s_cond_work);
+    pthread_mutex_unlock(&sp_pool->s_mutex);
+    return 1;
+}
+
+/*==============================================================================
+ PUBLIC FUNCTIONS
+ =============================================================================*/
+
+size_t cobs_encode_parallel(const void *vp_in, size_t s_in_size,
+                            uint8_t *u8p_out, size_t s_out_size,
+                            unsigned u_threads)
+{
+    assert(vp_in && u8p_out);
+
+    cobs_mt_encode_t s_enc;                          // Encode state
+    size_t s_chunks = s_in_size / COBS_MT_CHUNK_MIN; // Number of chunks
+    size_t s_chunk_size;                             // Chunk size before the split
+    unsigned u_chunks;                               // Number of chunks after the split
+    size_t s_block = 0;                              // Block start after the last zero
+    unsigned i;
+
+    if (u_threads > COBS_MT_THREADS_MAX)
+    {
+        u_threads = COBS_MT_THREADS_MAX;
+    }
+    if (s_chunks > u_threads)
+    {
+        s_chunks = u_threads;
+    }
+    if (s_chunks < 2U)
+    {
+        return cobs_encode(vp_in, s_in_size, u8p_out, s_out_size);
+    }
+    s_enc.u8p_in = (const uint8_t *)vp_in;
+    s_enc.s_in_size = s_in_size;
+    s_enc.u8p_out = u8p_out;
+    s_enc.u_chunks = (unsigned)s_chunks;
+    s_chunk_size = s_in_size / s_chunks;
+    for (i = 0; i < s_enc.u_chunks; i++)
+    {
+        s_enc.sa_start[i] = s_chunk_size * i;
+    }
+    s_enc.sa_start[s_enc.u_chunks] = s_in_size;
+    cobs_mt_run(s_enc.u_chunks, cobs_mt_encode_split, &s_enc);
+
+    /* Move every chunk start to the next block start. */
+    u_chunks = 1;
+    for (i = 1; i < s_enc.u_chunks; i++)
+    {
+        size_t s_start = s_enc.sa_start[i];
+        if (s_enc.sa_block[i] > (s_start - s_chunk_size))
+        {
+            s_block = s_enc.sa_block[i];
+        }
+        /* Without zeros blocks are full, from the last zero on. */
+        s_start = s_block + ((s_start - s_block + COBS_RUN_MAX - 1U) / COBS_RUN_MAX) * COBS_RUN_MAX;
+        if (s_enc.sa_zero[i] < s_start)
+        {
+            s_start = s_enc.sa_zero[i] + 1U;
+        }
+        if ((s_start < s_enc.sa_start[i + 1U]) && (s_start < s_in_size))
+        {
+            s_enc.sa_start[u_chunks] = s_start;
+            u_chunks++;
+        }
+    }
+    s_enc.sa_start[u_chunks] = s_in_size;
+    s_enc.u_chunks = u_chunks;
+
+    cobs_mt_run(s_enc.u_chunks, cobs_mt_encode_size, &s_enc);
+    s_enc.sa_offset[0] = 0;
+    for (i = 0; i < s_enc.u_chunks; i++)
+    {
+        s_enc.sa_offset[i + 1U] = s_enc.sa_offset[i] + s_enc.sa_size[i];
+    }
+    if (s_enc.sa_offset[s_enc.u_chunks] > s_out_size)
+    {
+        return 0;
+    }
+    cobs_mt_run(s_enc.u_chunks, cobs_mt_encode_chunk, &s_enc);
+    return s_enc.sa_offset[s_enc.u_chunks];
+}
+
+size_t cobs_decode_parallel(const uint8_t *u8p_in, size_t s_in_size,
+                            void *vp_out, size_t s_out_size,
+                            unsigned u_threads)
+{
+    assert(u8p_in && vp_out);
+
+    cobs_mt_decode_t s_dec;                          // Decode state
+    size_t s_chunks = s_in_size / COBS_MT_CHUNK_MIN; // Number of chunks
+    size_t s_chunk_size;                             // Input per chunk
+    size_t s_pos = 0;                                // Code byte position
+    size_t s_size = 0;                               // Decoded size
+    uint8_t u8_in_code_mem = COBS_BLOCK_SIZE;        // Last code
+    unsigned i;
+
+    if (u_threads > COBS_MT_THREADS_MAX)
+    {
+        u_threads = COBS_MT_THREADS_MAX;
+    }
+    if (s_chunks > u_threads)
+    {
+        s_chunks = u_threads;
+    }
+    if ((s_chunks < 2U) || (u8p_in[0] == COBS_FRAME_END) ||
+        (u8p_in[s_in_size - 1U] != COBS_FRAME_END))
+    {
+        /* Small, raw or unterminated input. */
+        return cobs_decode(u8p_in, s_in_size, vp_out, s_out_size);
+    }
+    s_chunk_size = s_in_size / s_chunks;
+    s_dec.u8p_in = u8p_in;
+    s_dec.s_in_size = s_in_size;
+    s_dec.u8p_out = (uint8_t *)vp_out;
+    s_dec.u_chunks = 0;
+
+    /* Follow the code bytes, cut the chain into chunks of similar input size. */
+    while (s_pos < (s_in_size - 1U))
+    {
+        uint8_t u8_code = u8p_in[s_pos];
+        if (u8_code == COBS_FRAME_END)
+        {
+            /* Early frame end, leave it to the serial decoder. */
+            return cobs_decode(u8p_in, s_in_size, vp_out, s_out_size);
+        }
+        if (s_pos > 0U)
+        {
+            if (s_size == s_out_size)
+            {
+                /* Output buffer too small. */
+                return 0;
+            }
+            if (u8_in_code_mem != COBS_BLOCK_SIZE)
+            {
+                /* Zero byte of the previous block. */
+                s_size++;
+            }
+        }
+        if ((s_dec.u_chunks < s_chunks) && (s_pos >= (s_chunk_size * s_dec.u_chunks)))
+        {
+            s_dec.sa_code[s_dec.u_chunks] = s_pos;
+            s_dec.sa_offset[s_dec.u_chunks] = s_size;
+            s_dec.ia_error[s_dec.u_chunks] = 0;
+            s_dec.u_chunks++;
+        }
+        u8_in_code_mem = u8_code;
+        s_size += (size_t)u8_code - 1U;
+        s_pos += u8_code;
+    }
+    if (s_pos != (s_in_size - 1U))
+    {
+        /* Truncated last block, leave it to the serial decoder. */
+        return cobs_decode(u8p_in, s_in_size, vp_out, s_out_size);
+    }
+    if (s_size > s_out_size)
+    {
+        /* Output buffer too small. */
+        return 0;
+    }
+    s_dec.sa_code[s_dec.u_chunks] = s_pos;
+
+    cobs_mt_run(s_dec.u_chunks, cobs_mt_decode_chunk, &s_dec);
+    for (i = 0; i < s_dec.u_chunks; i++)
+    {
+        if (s_dec.ia_error[i])
+        {
+            return 0;
+        }
+    }
+    return s_size;
+}
+
+cobs_pool_t *cobs_pool_create(unsigned u_threads, unsigned u_sources, size_t s_frame_max,
+                              cobs_pool_cb_t fp_frame, void *vp_ctx)
+{
+    assert(fp_frame);
+
+    cobs_pool_t *sp_pool; // New pool
+    unsigned i;
+
+    if ((u_threads == 0U) || (u_sources == 0U))
+    {
+        return NULL;
+    }
+    sp_pool = (cobs_pool_t *)calloc(1, sizeof(cobs_pool_t));
+    if (sp_pool == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_init(&sp_pool->s_mutex, NULL);
+    pthread_cond_init(&sp_pool->s_cond_work, NULL);
+    pthread_cond_init(&sp_pool->s_cond_idle, NULL);
+    sp_pool->s_in_max = COBS_ENCODE_OUT_SIZE_MIN(s_frame_max);
+    sp_pool->fp_frame = fp_frame;
+    sp_pool->vp_ctx = vp_ctx;
+    sp_pool->sp_workers = (cobs_pool_worker_t *)calloc(u_threads, sizeof(cobs_pool_worker_t));
+    sp_pool->sp_sources = (cobs_pool_source_t *)calloc(u_sources, sizeof(cobs_pool_source_t));
+    if ((sp_pool->sp_workers == NULL) || (sp_pool->sp_sources == NULL))
+    {
+        cobs_pool_destroy(sp_pool);
+        return NULL;
+    }
+    for (i = 0; i < u_sources; i++)
+    {
+        pthread_mutex_init(&sp_pool->sp_sources[i].s_mutex, NULL);
+    }
+    sp_pool->u_sources = u_sources;
+    for (i = 0; i < u_sources; i++)
+    {
+        sp_pool->sp_sources[i].u8p_part = (uint8_t *)malloc(sp_pool->s_in_max);
+        if (sp_pool->sp_sources[i].u8p_part == NULL)
+        {
+            cobs_pool_destroy(sp_pool);
+            return NULL;
+        }
+    }
+    for (i = 0; i < u_threads; i++)
+    {
+        pthread_mutex_init(&sp_pool->sp_workers[i].s_mutex, NULL);
+        sp_pool->sp_workers[i].sp_pool = sp_pool;
+        sp_pool->sp_workers[i].u_index = i;
+    }
+    /* All queues exist before the first thread looks for work. */
+    sp_pool->u_threads = u_threads;
+    for (i = 0; i < u_threads; i++)
+    {
+        if (pthread_create(&sp_pool->sp_workers[i].s_thread, NULL, cobs_pool_thread, &sp_pool->sp_workers[i]) != 0)
+        {
+            cobs_pool_destroy(sp_pool);
+            return NULL;
+        }
+        sp_pool->u_started = i + 1U;
+    }
+    return sp_pool;
+}
+
+size_t cobs_pool_push(cobs_pool_t *sp_pool, unsigned u_source,
+                      const uint8_t *u8p_in, size_t s_in_size)
+{
+    assert(sp_pool && u8p_in && (u_source < sp_pool->u_sources));
+
+    cobs_pool_source_t *sp_source = &sp_pool->sp_sources[u_source]; // Source of the data
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;                // Input end pointer
+    size_t s_frames = 0;                                            // Frames queued
+
+    while (u8p_in < u8p_in_end)
+    {
+        const uint8_t *u8p_zero = (const uint8_t *)memchr(u8p_in, COBS_FRAME_END, (size_t)(u8p_in_end - u8p_in));
+        size_t s_size = (u8p_zero != NULL) ? (size_t)(u8p_zero + 1 - u8p_in) : (size_t)(u8p_in_end - u8p_in);
+
+        if (u8p_zero == NULL)
+        {
+            /* Keep the incomplete frame for the next call. */
+            if ((sp_source->s_part_size + s_size) > sp_pool->s_in_max)
+            {
+                sp_source->i_part_drop = 1;
+                sp_source->s_part_size = 0;
+            }
+            else if (!sp_source->i_part_drop)
+            {
+                memcpy(sp_source->u8p_part + sp_source->s_part_size, u8p_in, s_size);
+                sp_source->s_part_size += s_size;
+            }
+        }
+        else if ((s_size > 1U) || (sp_source->s_part_size > 0U) || sp_source->i_part_drop)
+        {
+            /* Lone frame ends carry no frame. */
+            s_frames += (size_t)cobs_pool_queue(sp_pool, u_source, u8p_in, s_size);
+            sp_source->s_part_size = 0;
+            sp_source->i_part_drop = 0;
+        }
+        u8p_in += s_size;
+    }
+    return s_frames;
+}
+
+void cobs_pool_flush(cobs_pool_t *sp_pool)
+{
+    assert(sp_pool);
+
+    pthread_mutex_lock(&sp_pool->s_mutex);
+    while (sp_pool->s_pending > 0U)
+    {
+        pthread_cond_wait(&sp_pool->s_cond_idle, &sp_pool->s_mutex);
+    }
+    pthread_mutex_unlock(&sp_pool->s_mutex);
+}
+
+void cobs_pool_destroy(cobs_pool_t *sp_pool)
+{
+    unsigned i;
+
+    if (sp_pool == NULL)
+    {
+        return;
+    }
+    if (sp_pool->u_started > 0U)
+    {
+        cobs_pool_flush(sp_pool);
+    }
+    pthread_mutex_lock(&sp_pool->s_mutex);
+    sp_pool->i_stop = 1;
+    pthread_cond_broadcast(&sp_pool->s_cond_work);
+    pthread_mutex_unlock(&sp_pool->s_mutex);
+    for (i = 0; i < sp_pool->u_started; i++)
+    {
+        (void)pthread_join(sp_pool->sp_workers[i].s_thread, NULL);
+    }
+    for (i = 0; i < sp_pool->u_threads; i++)
+    {
+        pthread_mutex_destroy(&sp_pool->sp_workers[i].s_mutex);
+    }
+    for (i = 0; i < sp_pool->u_sources; i++)
+    {
+        pthread_mutex_destroy(&sp_pool->sp_sources[i].s_mutex);
+        free(sp_pool->sp_sources[i].u8p_part);
+    }
+    pthread_cond_destroy(&sp_pool->s_cond_idle);
+    pthread_cond_destroy(&sp_pool->s_cond_work);
+    pthread_mutex_destroy(&sp_pool->s_mutex);
+    free(sp_pool->sp_sources);
+    free(sp_pool->sp_workers);
+    free(sp_pool);
+}
+
+/*
+ * @copyright
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source u8_code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
@@ -0,0 +1,145 @@
+/** @file cobs_mt.h
+ *
+ * @author Falk Kyburz
+ * @brief Multi-threaded Consistent Overhead Byte Stuffing
+ *
+ */
+
+#ifndef COBS_MT_H
+#define COBS_MT_H
+
+/*==============================================================================
+ INCLUDES
+ =============================================================================*/
+#include "cobs.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*==============================================================================
+ DEFINES
+ =============================================================================*/
+#define COBS_MT_THREADS_MAX (64U)
+#define COBS_MT_CHUNK_MIN (65536U)
+
+/*==============================================================================
+ PUBLIC TYPES
+ =============================================================================*/
+
+/** Decode pool, see cobs_pool_create(). */
+typedef struct cobs_pool cobs_pool_t;
+
+/** Called by the decode pool for every frame of a source, in order. */
+typedef void (*cobs_pool_cb_t)(void *vp_ctx, unsigned u_source,
+                               const uint8_t *u8p_frame, size_t s_size, int i_status);
+
+/*==============================================================================
+ PUBLIC FUNCTIONS
+ =============================================================================*/
+
+/**
+ * @brief COBS encode a large buffer with several threads
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @param u8p_out Pointer to encoded output buffer
+ * @param s_out_size Size of output data
+ * @param u_threads Number of threads to use, including the calling thread
+ * @return Encoded buffer size in bytes
+ * @note The output is identical to cobs_encode(). The input is split at
+ * block starts, every thread gets at least COBS_MT_CHUNK_MIN bytes. Returns
+ * zero if not all data was encoded.
+ */
+size_t cobs_encode_parallel(const void *vp_in, size_t s_in_size,
+                            uint8_t *u8p_out, size_t s_out_size,
+                            unsigned u_threads);
+
+/**
+ * @brief COBS decode a large frame with several threads
+ * @param u8p_in Pointer to encoded input bytes
+ * @param s_in_size Size of input data
+ * @param vp_out Pointer to decoded output buffer
+ * @param s_out_size Size of output data
+ * @param u_threads Number of threads to use, including the calling thread
+ * @return Number of bytes successfully decoded
+ * @note Returns the same as cobs_decode(). The code bytes are followed once
+ * to find the output offset of every block, then the runs are copied in
+ * parallel. Frames whose code bytes do not chain up to the frame end are
+ * decoded by cobs_decode().
+ */
+size_t cobs_decode_parallel(const uint8_t *u8p_in, size_t s_in_size,
+                            void *vp_out, size_t s_out_size,
+                            unsigned u_threads);
+
+/**
+ * @brief Create a pool of threads decoding frames from several sources
+ * @param u_threads Number of decode threads
+ * @param u_sources Number of sources, e.g. links
+ * @param s_frame_max Maximum decoded frame size
+ * @param fp_frame Callback for every decoded frame
+ * @param vp_ctx Callback context
+ * @return Pointer to the pool, NULL if out of memory or threads
+ * @note Frames are decoded by whichever thread is free, idle threads steal
+ * queued frames from busy ones. fp_frame runs on the decode threads, but
+ * the calls for one source never overlap and come in the order the frames
+ * were pushed. Frames decode as with cobs_decode() and cobs_decode_many().
+ * The status is COBS_FRAME_OK, or COBS_FRAME_INVALID with size zero for
+ * frames longer than COBS_ENCODE_OUT_SIZE_MIN(s_frame_max) encoded.
+ */
+cobs_pool_t *cobs_pool_create(unsigned u_threads, unsigned u_sources, size_t s_frame_max,
+                              cobs_pool_cb_t fp_frame, void *vp_ctx);
+
+/**
+ * @brief Queue the next chunk of a source's byte stream for decoding
+ * @param sp_pool Pointer to the pool
+ * @param u_source Source index
+ * @param u8p_in Pointer to encoded input bytes, frames split anywhere
+ * @param s_in_size Size of input data
+ * @return Number of frames queued, the input buffer can be reused
+ * @note Finds the frame ends on the calling thread and keeps an incomplete
+ * last frame for the next call. Chunks of one source must be pushed from
+ * one thread at a time, different sources may be pushed concurrently.
+ */
+size_t cobs_pool_push(cobs_pool_t *sp_pool, unsigned u_source,
+                      const uint8_t *u8p_in, size_t s_in_size);
+
+/**
+ * @brief Wait until all queued frames have been delivered
+ * @param sp_pool Pointer to the pool
+ */
+void cobs_pool_flush(cobs_pool_t *sp_pool);
+
+/**
+ * @brief Deliver all queued frames, stop the threads and free the pool
+ * @param sp_pool Pointer to the pool, may be NULL
+ */
+void cobs_pool_destroy(cobs_pool_t *sp_pool);
+
+#endif /* COBS_MT_H */
+
+/*
+ * @copyright
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
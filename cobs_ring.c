@@ -0,0 +1,313 @@
+/** @file cobs_ring.c
+ *
+ * @author Falk Kyburz
+ * @brief Lock-free rings for COBS encoded byte streams
+ *
+ */
+
+/*==============================================================================
+ INCLUDES
+ =============================================================================*/
+#include "cobs_ring.h"
+
+#include <assert.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*==============================================================================
+ PRIVATE DEFINES
+ =============================================================================*/
+#define COBS_FRAME_END (0U)
+
+/*==============================================================================
+ PRIVATE FUNCTIONS
+ =============================================================================*/
+
+/**
+ * @brief Frame callback of the decoder used for wrapped frames
+ * @param vp_ctx Pointer to the decoded size
+ * @param u8p_frame Pointer to the decoded frame
+ * @param s_size Decoded size
+ */
+static void cobs_ring_frame(void *vp_ctx, const uint8_t *u8p_frame, size_t s_size)
+{
+    (void)u8p_frame;
+    *(size_t *)vp_ctx = s_size;
+}
+
+/**
+ * @brief Decode a frame that wraps around the end of the ring
+ * @param sp_ring Pointer to the ring
+ * @param s_start Frame start index
+ * @param s_in_size Size of the frame, including the frame end
+ * @param vp_out Pointer to decoded output buffer
+ * @param s_out_size Size of output data
+ * @return Decoded size, zero if the frame did not decode
+ */
+static size_t cobs_ring_decode_wrapped(cobs_ring_t *sp_ring, size_t s_start, size_t s_in_size,
+                                       void *vp_out, size_t s_out_size)
+{
+    size_t s_pos = s_start & (sp_ring->s_size - 1U);  // Frame start in the buffer
+    size_t s_first = sp_ring->s_size - s_pos;         // Bytes up to the ring end
+    size_t s_size = 0;                                // Decoded size
+    cobs_decoder_t s_dec;                             // Decoder state
+
+    cobs_decoder_init(&s_dec, (uint8_t *)vp_out, s_out_size, cobs_ring_frame, &s_size);
+    (void)cobs_decoder_update(&s_dec, sp_ring->u8p_buf + s_pos, s_first);
+    (void)cobs_decoder_update(&s_dec, sp_ring->u8p_buf, s_in_size - s_first);
+    return s_size;
+}
+
+/**
+ * @brief Publish the read index to the producer
+ * @param sp_ring Pointer to the ring
+ */
+static void cobs_ring_read_publish(cobs_ring_t *sp_ring)
+{
+    atomic_store_explicit(&sp_ring->s_tail, sp_ring->s_tail_local, memory_order_release);
+}
+
+/*==============================================================================
+ PUBLIC FUNCTIONS
+ =============================================================================*/
+
+int cobs_ring_init(cobs_ring_t *sp_ring, uint8_t *u8p_buf, size_t s_buf_size)
+{
+    assert(sp_ring && u8p_buf);
+
+    if ((s_buf_size == 0U) || ((s_buf_size & (s_buf_size - 1U)) != 0U))
+    {
+        return 0;
+    }
+    atomic_init(&sp_ring->s_head, 0);
+    atomic_init(&sp_ring->s_tail, 0);
+    sp_ring->s_tail_cache = 0;
+    sp_ring->s_tail_local = 0;
+    sp_ring->s_head_cache = 0;
+    sp_ring->s_scan = 0;
+    sp_ring->i_drop = 0;
+    sp_ring->u8p_buf = u8p_buf;
+    sp_ring->s_size = s_buf_size;
+    sp_ring->s_batch = s_buf_size / 4U;
+    return 1;
+}
+
+uint8_t *cobs_ring_write_begin(cobs_ring_t *sp_ring, size_t *sp_size)
+{
+    assert(sp_ring && sp_size);
+
+    size_t s_head = atomic_load_explicit(&sp_ring->s_head, memory_order_relaxed); // Write index
+    size_t s_pos = s_head & (sp_ring->s_size - 1U);                               // Write position
+    size_t s_free = sp_ring->s_size - (s_head - sp_ring->s_tail_cache);          // Free space
+
+    if (s_free == 0U)
+    {
+        /* Only look at the consumer's cache line when out of space. */
+        sp_ring->s_tail_cache = atomic_load_explicit(&sp_ring->s_tail, memory_order_acquire);
+        s_free = sp_ring->s_size - (s_head - sp_ring->s_tail_cache);
+    }
+    *sp_size = ((sp_ring->s_size - s_pos) < s_free) ? (sp_ring->s_size - s_pos) : s_free;
+    return sp_ring->u8p_buf + s_pos;
+}
+
+void cobs_ring_write_commit(cobs_ring_t *sp_ring, size_t s_size)
+{
+    assert(sp_ring);
+
+    size_t s_head = atomic_load_explicit(&sp_ring->s_head, memory_order_relaxed); // Write index
+
+    atomic_store_explicit(&sp_ring->s_head, s_head + s_size, memory_order_release);
+}
+
+size_t cobs_ring_write(cobs_ring_t *sp_ring, const void *vp_in, size_t s_in_size)
+{
+    assert(sp_ring && vp_in);
+
+    const uint8_t *u8p_in = (const uint8_t *)vp_in; // Input data pointer
+    size_t s_written = 0;                           // Bytes written
+
+    while (s_written < s_in_size)
+    {
+        size_t s_free;
+        uint8_t *u8p_free = cobs_ring_write_begin(sp_ring, &s_free);
+        size_t s_size = ((s_in_size - s_written) < s_free) ? (s_in_size - s_written) : s_free;
+        if (s_size == 0U)
+        {
+            /* Ring full. */
+            break;
+        }
+        memcpy(u8p_free, u8p_in + s_written, s_size);
+        cobs_ring_write_commit(sp_ring, s_size);
+        s_written += s_size;
+    }
+    return s_written;
+}
+
+int cobs_ring_read(cobs_ring_t *sp_ring, void *vp_out, size_t s_out_size, size_t *sp_size)
+{
+    assert(sp_ring && vp_out && sp_size);
+
+    const size_t s_mask = sp_ring->s_size - 1U; // Index to position mask
+
+    for (;;)
+    {
+        size_t s_start = sp_ring->s_tail_local; // Frame start index
+        size_t s_scan = sp_ring->s_scan;        // Search start index
+        if (s_scan == sp_ring->s_head_cache)
+        {
+            /* Only look at the producer's cache line when out of data. */
+            sp_ring->s_head_cache = atomic_load_explicit(&sp_ring->s_head, memory_order_acquire);
+            if (s_scan == sp_ring->s_head_cache)
+            {
+                cobs_ring_read_publish(sp_ring);
+                return 0;
+            }
+        }
+        size_t s_avail = sp_ring->s_head_cache - s_scan;
+        size_t s_span = ((sp_ring->s_size - (s_scan & s_mask)) < s_avail) ? (sp_ring->s_size - (s_scan & s_mask)) : s_avail;
+        const uint8_t *u8p_scan = sp_ring->u8p_buf + (s_scan & s_mask);
+        const uint8_t *u8p_zero = (const uint8_t *)memchr(u8p_scan, COBS_FRAME_END, s_span);
+        if (u8p_zero == NULL)
+        {
+            sp_ring->s_scan = s_scan + s_span;
+            if ((sp_ring->s_scan - s_start) == sp_ring->s_size)
+            {
+                /* Frame longer than the ring, skip it. */
+                sp_ring->i_drop = 1;
+                sp_ring->s_tail_local = sp_ring->s_scan;
+                cobs_ring_read_publish(sp_ring);
+            }
+            continue;
+        }
+        sp_ring->s_scan = s_scan + (size_t)(u8p_zero - u8p_scan) + 1U;
+        sp_ring->s_tail_local = sp_ring->s_scan;
+        size_t s_in_size = sp_ring->s_scan - s_start;
+        /* Lone frame ends and the end of a skipped frame carry no frame. */
+        int i_frame = (s_in_size > 1U) && !sp_ring->i_drop;
+        if (i_frame && (((s_start & s_mask) + s_in_size) <= sp_ring->s_size))
+        {
+            *sp_size = cobs_decode(sp_ring->u8p_buf + (s_start & s_mask), s_in_size, vp_out, s_out_size);
+        }
+        else if (i_frame)
+        {
+            /* Frame wraps around the ring end. */
+            *sp_size = cobs_ring_decode_wrapped(sp_ring, s_start, s_in_size, vp_out, s_out_size);
+        }
+        sp_ring->i_drop = 0;
+        if ((sp_ring->s_tail_local - atomic_load_explicit(&sp_ring->s_tail, memory_order_relaxed)) >= sp_ring->s_batch)
+        {
+            cobs_ring_read_publish(sp_ring);
+        }
+        if (i_frame)
+        {
+            return 1;
+        }
+    }
+}
+
+int cobs_tx_ring_init(cobs_tx_ring_t *sp_ring, uint8_t *u8p_buf,
+                      size_t s_ring_size, size_t s_frame_max)
+{
+    assert(sp_ring && u8p_buf);
+
+    if ((s_ring_size == 0U) || ((s_ring_size & (s_ring_size - 1U)) != 0U) ||
+        (COBS_ENCODE_OUT_SIZE_MIN(s_frame_max) > s_ring_size))
+    {
+        return 0;
+    }
+    atomic_init(&sp_ring->s_reserve, 0);
+    atomic_init(&sp_ring->s_commit, 0);
+    atomic_init(&sp_ring->s_tail, 0);
+    sp_ring->u8p_buf = u8p_buf;
+    sp_ring->s_size = s_ring_size;
+    sp_ring->s_frame_max = s_frame_max;
+    return 1;
+}
+
+size_t cobs_tx_ring_send(cobs_tx_ring_t *sp_ring, const void *vp_in, size_t s_in_size)
+{
+    assert(sp_ring && vp_in);
+
+    size_t s_len = COBS_ENCODE_OUT_SIZE_MIN(s_in_size); // Reserved size
+    size_t s_start;                                     // Reservation start index
+    size_t s_pos;                                       // Reservation start position
+    size_t s_size;                                      // Encoded size
+
+    if (s_in_size > sp_ring->s_frame_max)
+    {
+        return 0;
+    }
+    s_start = atomic_fetch_add_explicit(&sp_ring->s_reserve, s_len, memory_order_relaxed);
+    while ((s_start + s_len - atomic_load_explicit(&sp_ring->s_tail, memory_order_acquire)) > sp_ring->s_size)
+    {
+        /* Ring full, wait for the drain thread. */
+        (void)sched_yield();
+    }
+    s_pos = s_start & (sp_ring->s_size - 1U);
+    s_size = cobs_encode(vp_in, s_in_size, sp_ring->u8p_buf + s_pos, s_len);
+    memset(sp_ring->u8p_buf + s_pos + s_size, COBS_FRAME_END, s_len - s_size);
+    if ((s_pos + s_len) > sp_ring->s_size)
+    {
+        /* Move the part behind the ring end to the ring start. */
+        memcpy(sp_ring->u8p_buf, sp_ring->u8p_buf + sp_ring->s_size, s_pos + s_len - sp_ring->s_size);
+    }
+    while (atomic_load_explicit(&sp_ring->s_commit, memory_order_acquire) != s_start)
+    {
+        /* Earlier reservations commit first. */
+        (void)sched_yield();
+    }
+    atomic_store_explicit(&sp_ring->s_commit, s_start + s_len, memory_order_release);
+    return s_size;
+}
+
+const uint8_t *cobs_tx_ring_drain_begin(cobs_tx_ring_t *sp_ring, size_t *sp_size)
+{
+    assert(sp_ring && sp_size);
+
+    size_t s_tail = atomic_load_explicit(&sp_ring->s_tail, memory_order_relaxed);     // Sent index
+    size_t s_commit = atomic_load_explicit(&sp_ring->s_commit, memory_order_acquire); // Committed index
+    size_t s_pos = s_tail & (sp_ring->s_size - 1U);                                   // Sent position
+
+    *sp_size = ((s_commit - s_tail) < (sp_ring->s_size - s_pos)) ? (s_commit - s_tail) : (sp_ring->s_size - s_pos);
+    return sp_ring->u8p_buf + s_pos;
+}
+
+void cobs_tx_ring_drain_end(cobs_tx_ring_t *sp_ring, size_t s_size)
+{
+    assert(sp_ring);
+
+    size_t s_tail = atomic_load_explicit(&sp_ring->s_tail, memory_order_relaxed); // Sent index
+
+    atomic_store_explicit(&sp_ring->s_tail, s_tail + s_size, memory_order_release);
+}
+
+/*
+ * @copyright
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
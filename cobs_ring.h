@@ -0,0 +1,196 @@
+/** @file cobs_ring.h
+ *
+ * @author Falk Kyburz
+ * @brief Lock-free rings for COBS encoded byte streams
+ *
+ */
+
+#ifndef COBS_RING_H
+#define COBS_RING_H
+
+/*==============================================================================
+ INCLUDES
+ =============================================================================*/
+#include "cobs.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*==============================================================================
+ DEFINES
+ =============================================================================*/
+#define COBS_RING_CACHE_LINE (64U)
+#define COBS_TX_RING_BUF_SIZE(RING_SIZE, FRAME_MAX) \
+    ((RING_SIZE) + COBS_ENCODE_OUT_SIZE_MIN(FRAME_MAX))
+
+/*==============================================================================
+ PUBLIC TYPES
+ =============================================================================*/
+
+/** Single-producer/single-consumer receive ring, see cobs_ring_init(). */
+typedef struct
+{
+    /* Producer */
+    _Alignas(COBS_RING_CACHE_LINE) atomic_size_t s_head; // Write index, published
+    size_t s_tail_cache;                                 // Read index last seen by the producer
+    /* Consumer */
+    _Alignas(COBS_RING_CACHE_LINE) atomic_size_t s_tail; // Read index, published
+    size_t s_tail_local;                                 // Read index, published in batches
+    size_t s_head_cache;                                 // Write index last seen by the consumer
+    size_t s_scan;                                       // Searched for a frame end up to here
+    int i_drop;                                          // Set while skipping an oversized frame
+    /* Shared, constant */
+    _Alignas(COBS_RING_CACHE_LINE) uint8_t *u8p_buf;     // Ring buffer
+    size_t s_size;                                       // Ring buffer size, a power of two
+    size_t s_batch;                                      // Read index publish interval
+} cobs_ring_t;
+
+/** Multi-producer/single-consumer transmit ring, see cobs_tx_ring_init(). */
+typedef struct
+{
+    /* Producers */
+    _Alignas(COBS_RING_CACHE_LINE) atomic_size_t s_reserve; // Next free index
+    _Alignas(COBS_RING_CACHE_LINE) atomic_size_t s_commit;  // Encoded up to here
+    /* Consumer */
+    _Alignas(COBS_RING_CACHE_LINE) atomic_size_t s_tail;    // Sent up to here
+    /* Shared, constant */
+    _Alignas(COBS_RING_CACHE_LINE) uint8_t *u8p_buf;        // Ring buffer
+    size_t s_size;                                          // Ring size, a power of two
+    size_t s_frame_max;                                     // Maximum frame size
+} cobs_tx_ring_t;
+
+/*==============================================================================
+ PUBLIC FUNCTIONS
+ =============================================================================*/
+
+/**
+ * @brief Set up a receive ring
+ * @param sp_ring Pointer to the ring
+ * @param u8p_buf Pointer to the ring buffer
+ * @param s_buf_size Size of the ring buffer, a power of two
+ * @return Non-zero on success, zero if the size is not a power of two
+ * @note One thread writes encoded bytes, another reads decoded frames. No
+ * locks are taken, the indices are published with release/acquire.
+ */
+int cobs_ring_init(cobs_ring_t *sp_ring, uint8_t *u8p_buf, size_t s_buf_size);
+
+/**
+ * @brief Get free space to receive encoded bytes into
+ * @param sp_ring Pointer to the ring
+ * @param sp_size Pointer to the contiguous free size
+ * @return Pointer to the free space
+ * @note Producer only. Pass the number of bytes written to
+ * cobs_ring_write_commit().
+ */
+uint8_t *cobs_ring_write_begin(cobs_ring_t *sp_ring, size_t *sp_size);
+
+/**
+ * @brief Publish received bytes to the consumer
+ * @param sp_ring Pointer to the ring
+ * @param s_size Number of bytes written, at most the size from
+ * cobs_ring_write_begin()
+ * @note Producer only.
+ */
+void cobs_ring_write_commit(cobs_ring_t *sp_ring, size_t s_size);
+
+/**
+ * @brief Copy encoded bytes into the ring
+ * @param sp_ring Pointer to the ring
+ * @param vp_in Pointer to encoded input bytes, frames split anywhere
+ * @param s_in_size Size of input data
+ * @return Number of bytes written, less than s_in_size if the ring is full
+ * @note Producer only.
+ */
+size_t cobs_ring_write(cobs_ring_t *sp_ring, const void *vp_in, size_t s_in_size);
+
+/**
+ * @brief Decode the next complete frame from the ring
+ * @param sp_ring Pointer to the ring
+ * @param vp_out Pointer to decoded output buffer
+ * @param s_out_size Size of output data
+ * @param sp_size Pointer to the decoded size, zero if the frame did not decode
+ * @return Non-zero if a frame was read, zero if there is no complete frame
+ * @note Consumer only. The read index is published every quarter ring and
+ * whenever the ring runs out of frames. Frames longer than the ring are
+ * skipped.
+ */
+int cobs_ring_read(cobs_ring_t *sp_ring, void *vp_out, size_t s_out_size, size_t *sp_size);
+
+/**
+ * @brief Set up a transmit ring
+ * @param sp_ring Pointer to the ring
+ * @param u8p_buf Pointer to COBS_TX_RING_BUF_SIZE(s_ring_size, s_frame_max)
+ * bytes of ring buffer
+ * @param s_ring_size Size of the ring, a power of two
+ * @param s_frame_max Maximum frame size
+ * @return Non-zero on success, zero if the sizes do not fit
+ * @note Any number of threads send frames, one thread drains the encoded
+ * bytes. Frames that cross the ring end are encoded into the spare bytes
+ * behind it and copied to the ring start.
+ */
+int cobs_tx_ring_init(cobs_tx_ring_t *sp_ring, uint8_t *u8p_buf,
+                      size_t s_ring_size, size_t s_frame_max);
+
+/**
+ * @brief COBS encode a frame into the transmit ring
+ * @param sp_ring Pointer to the ring
+ * @param vp_in Pointer to input data to encode
+ * @param s_in_size Size of input data
+ * @return Encoded size in bytes, zero if the frame is too large
+ * @note Reserves COBS_ENCODE_OUT_SIZE_MIN(s_in_size) bytes with one atomic
+ * add, waits for the drain thread if the ring is full and encodes straight
+ * into the reservation. Unused reserved bytes are sent as frame ends, which
+ * receivers skip as empty. Reservations are committed in order, a sender
+ * waits for earlier ones to finish encoding.
+ */
+size_t cobs_tx_ring_send(cobs_tx_ring_t *sp_ring, const void *vp_in, size_t s_in_size);
+
+/**
+ * @brief Get the committed bytes to send
+ * @param sp_ring Pointer to the ring
+ * @param sp_size Pointer to the contiguous committed size
+ * @return Pointer to the committed bytes
+ * @note Drain thread only. Pass the number of bytes sent to
+ * cobs_tx_ring_drain_end().
+ */
+const uint8_t *cobs_tx_ring_drain_begin(cobs_tx_ring_t *sp_ring, size_t *sp_size);
+
+/**
+ * @brief Release sent bytes to the senders
+ * @param sp_ring Pointer to the ring
+ * @param s_size Number of bytes sent, at most the size from
+ * cobs_tx_ring_drain_begin()
+ * @note Drain thread only.
+ */
+void cobs_tx_ring_drain_end(cobs_tx_ring_t *sp_ring, size_t s_size);
+
+#endif /* COBS_RING_H */
+
+/*
+ * @copyright
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
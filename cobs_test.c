@@ -20,8 +20,14 @@
  */
 
 #include "cobs.h"
+#include "cobs_mt.h"
+#include "cobs_ring.h"
 
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "utest.h"
@@ -43,6 +49,254 @@ void memprint(void *mem, size_t size, size_t offset)
     printf("\n");
 }
 
+/**
+ * @brief Reference byte-by-byte encoder the optimized encoders must match.
+ */
+size_t cobs_encode_ref(const void *vp_in, size_t s_in_size,
+                       uint8_t *u8p_out, size_t s_out_size)
+{
+    const uint8_t *u8p_in = (const uint8_t *)vp_in;
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;
+    const uint8_t *u8p_out_end = u8p_out + s_out_size;
+    const uint8_t *u8p_out_start = u8p_out;
+    uint8_t *u8p_out_code = u8p_out;
+
+    for (u8p_out++; u8p_out < u8p_out_end; u8p_out++)
+    {
+        if (u8p_in < u8p_in_end)
+        {
+            if ((u8p_out - u8p_out_code) < 255)
+            {
+                if (*u8p_in == 0)
+                {
+                    *u8p_out_code = u8p_out - u8p_out_code;
+                    u8p_out_code = u8p_out;
+                }
+                else
+                {
+                    *u8p_out = *u8p_in;
+                }
+                u8p_in++;
+            }
+            else
+            {
+                *u8p_out_code = 255;
+                u8p_out_code = u8p_out;
+            }
+        }
+        else
+        {
+            *u8p_out_code = u8p_out - u8p_out_code;
+            u8p_out_code = u8p_out;
+            *u8p_out_code = 0;
+            u8p_out++;
+            break;
+        }
+    }
+    if ((u8p_in == u8p_in_end) && (*u8p_out_code == 0))
+    {
+        return (size_t)(u8p_out - u8p_out_start);
+    }
+    return 0;
+}
+
+/**
+ * @brief Reference byte-by-byte decoder the optimized decoders must match.
+ */
+size_t cobs_decode_ref(const uint8_t *u8p_in, size_t s_in_size,
+                       void *vp_out, size_t s_out_size)
+{
+    uint8_t *u8p_out = (uint8_t *)vp_out;
+    const uint8_t *u8p_in_end = u8p_in + s_in_size;
+    const uint8_t *u8p_out_end = u8p_out + s_out_size;
+    const uint8_t *u8p_out_start = u8p_out;
+    const uint8_t *u8p_in_code = u8p_in + *u8p_in;
+    uint8_t u8_in_code_mem = *u8p_in;
+
+    for (u8p_in++; u8p_in < u8p_in_end; u8p_in++)
+    {
+        if ((*u8p_in != 0) && (u8p_out < u8p_out_end))
+        {
+            if ((u8p_in == u8p_in_code) && (*u8p_in_code != 0))
+            {
+                if (u8_in_code_mem != 255)
+                {
+                    *u8p_out = 0;
+                    u8p_out++;
+                }
+                u8p_in_code = u8p_in + *u8p_in;
+                u8_in_code_mem = *u8p_in;
+            }
+            else
+            {
+                *u8p_out = *u8p_in;
+                u8p_out++;
+            }
+        }
+        else
+        {
+            u8_in_code_mem = *u8p_in;
+            u8p_in++;
+            break;
+        }
+    }
+    if ((u8p_in == u8p_in_end) && (u8_in_code_mem == 0))
+    {
+        return (size_t)(u8p_out - u8p_out_start);
+    }
+    return 0;
+}
+
+/** All kernel names, the ones the CPU lacks are skipped by the tests. */
+const char *cpa_kernels[] = {"scalar", "swar", "sse2", "avx2", "avx512bw"};
+
+/** Frames collected by the decoder callback. */
+typedef struct
+{
+    uint8_t u8a_data[16 * 700];
+    size_t sa_size[16];
+    int ia_status[16];
+    size_t s_frames;
+    size_t s_used;
+} frames_t;
+
+void frames_collect(void *vp_ctx, const uint8_t *u8p_frame, size_t s_size)
+{
+    frames_t *sp_frames = (frames_t *)vp_ctx;
+
+    memcpy(sp_frames->u8a_data + sp_frames->s_used, u8p_frame, s_size);
+    sp_frames->sa_size[sp_frames->s_frames++] = s_size;
+    sp_frames->s_used += s_size;
+}
+
+void frames_collect_pool(void *vp_ctx, unsigned u_source, const uint8_t *u8p_frame,
+                         size_t s_size, int i_status)
+{
+    frames_t *sp_frames = (frames_t *)vp_ctx + u_source;
+
+    sp_frames->ia_status[sp_frames->s_frames] = i_status;
+    frames_collect(sp_frames, u8p_frame, s_size);
+}
+
+/**
+ * @brief Fill a buffer with random bytes, roughly one in u_zero_every is zero.
+ */
+void memrand(uint8_t *u8p_mem, size_t s_size, unsigned u_zero_every)
+{
+    for (size_t i = 0; i < s_size; i++)
+    {
+        u8p_mem[i] = (uint8_t)(1 + rand() % 255);
+        if ((u_zero_every != 0) && ((rand() % u_zero_every) == 0))
+        {
+            u8p_mem[i] = 0;
+        }
+    }
+}
+
+/** Sources of the concurrent pool test, source 0 is pushed by pool_push_loop(). */
+typedef struct
+{
+    cobs_pool_t *sp_pool;
+    size_t sa_delivered[2];
+    atomic_int i_stop;
+} pool_sources_t;
+
+void pool_count(void *vp_ctx, unsigned u_source, const uint8_t *u8p_frame,
+                size_t s_size, int i_status)
+{
+    pool_sources_t *sp_sources = (pool_sources_t *)vp_ctx;
+
+    (void)u8p_frame;
+    (void)s_size;
+    (void)i_status;
+    sp_sources->sa_delivered[u_source]++;
+}
+
+/**
+ * @brief Pushes frames of source 0 until told to stop.
+ */
+void *pool_push_loop(void *vp_sources)
+{
+    pool_sources_t *sp_sources = (pool_sources_t *)vp_sources;
+    const uint8_t u8a_frame[] = {0x03, 0x11, 0x22, 0x00};
+
+    while (!atomic_load(&sp_sources->i_stop))
+    {
+        cobs_pool_push(sp_sources->sp_pool, 0, u8a_frame, sizeof(u8a_frame));
+        sched_yield();
+    }
+    return NULL;
+}
+
+/** Frames sent through the ring by ring_produce(). */
+typedef struct
+{
+    cobs_ring_t s_ring;
+    uint8_t u8a_data[2000][300];
+    size_t sa_size[2000];
+} ring_frames_t;
+
+/**
+ * @brief Producer thread of the ring test, writes all frames encoded.
+ */
+void *ring_produce(void *vp_frames)
+{
+    ring_frames_t *sp_frames = (ring_frames_t *)vp_frames;
+    uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(300)];
+
+    for (int k = 0; k < 2000; k++)
+    {
+        size_t s_code_size = cobs_encode(sp_frames->u8a_data[k], sp_frames->sa_size[k], u8a_code, sizeof(u8a_code));
+        for (size_t s_pos = 0; s_pos < s_code_size;)
+        {
+            size_t s_free;
+            uint8_t *u8p_free = cobs_ring_write_begin(&sp_frames->s_ring, &s_free);
+            size_t s_chunk = ((s_code_size - s_pos) < s_free) ? (s_code_size - s_pos) : s_free;
+            memcpy(u8p_free, u8a_code + s_pos, s_chunk);
+            cobs_ring_write_commit(&sp_frames->s_ring, s_chunk);
+            s_pos += s_chunk;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Payload of frame u_seq sent by thread u_thread in the tx ring test.
+ */
+size_t tx_frame(uint8_t *u8p_data, unsigned u_thread, unsigned u_seq)
+{
+    size_t s_size = 4 + (u_seq * 37U + u_thread * 11U) % 300U;
+
+    u8p_data[0] = (uint8_t)u_thread;
+    u8p_data[1] = (uint8_t)u_seq;
+    u8p_data[2] = (uint8_t)(u_seq >> 8);
+    for (size_t i = 3; i < s_size; i++)
+    {
+        u8p_data[i] = (uint8_t)(u_seq * 31U + i * 7U + u_thread);
+    }
+    return s_size;
+}
+
+/** Sender thread of the tx ring test. */
+typedef struct
+{
+    cobs_tx_ring_t *sp_ring;
+    unsigned u_thread;
+} tx_sender_t;
+
+void *tx_send(void *vp_sender)
+{
+    tx_sender_t *sp_sender = (tx_sender_t *)vp_sender;
+    uint8_t u8a_data[304];
+
+    for (unsigned u_seq = 0; u_seq < 2000; u_seq++)
+    {
+        size_t s_size = tx_frame(u8a_data, sp_sender->u_thread, u_seq);
+        cobs_tx_ring_send(sp_sender->sp_ring, u8a_data, s_size);
+    }
+    return NULL;
+}
+
 /*==============================================================================
  TEST FUNCTIONS
  =============================================================================*/
@@ -603,6 +857,1302 @@ UTEST(cobs, protocol_issue)
     // memprint(u8a_data_out, sizeof(u8a_data_out), 0);
 }
 
+UTEST(cobs, truncated_frames)
+{
+    /* A code byte pointing past the frame end cuts the frame short, every
+       receive path splits and decodes this stream the same way. */
+    const uint8_t u8a_stream[] = {0x05, 0x11, 0x00, 0x05, 0x00, 0x01, 0x00,
+                                  0x02, 0x11, 0x01, 0x00, 0x03, 0x11, 0x22, 0x00};
+    const size_t sa_frame_size[] = {3, 2, 2, 4, 4};
+    const size_t sa_exp_size[] = {1, 0, 0, 2, 2};
+    const uint8_t u8a_exp[] = {0x11, 0x11, 0x00, 0x11, 0x22};
+    static frames_t s_frames;
+    static uint8_t u8a_buf[64];
+    uint8_t u8a_out[16];
+    cobs_frame_t sa_many[8];
+    cobs_decoder_t s_dec;
+    cobs_ring_t s_ring;
+    cobs_pool_t *sp_pool;
+    size_t s_pos = 0;
+    size_t s_used = 0;
+    size_t s_size;
+
+    for (size_t i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(cobs_decode(u8a_stream + s_pos, sa_frame_size[i], u8a_out, sizeof(u8a_out)), sa_exp_size[i]);
+        EXPECT_EQ(memcmp(u8a_out, u8a_exp + s_used, sa_exp_size[i]), 0);
+        s_pos += sa_frame_size[i];
+        s_used += sa_exp_size[i];
+    }
+
+    memset(&s_frames, 0, sizeof(s_frames));
+    cobs_decoder_init(&s_dec, u8a_buf, sizeof(u8a_buf), frames_collect, &s_frames);
+    EXPECT_EQ(cobs_decoder_update(&s_dec, u8a_stream, sizeof(u8a_stream)), 5);
+    EXPECT_EQ(memcmp(s_frames.sa_size, sa_exp_size, sizeof(sa_exp_size)), 0);
+    EXPECT_EQ(memcmp(s_frames.u8a_data, u8a_exp, sizeof(u8a_exp)), 0);
+
+    EXPECT_EQ(cobs_decode_many(u8a_stream, sizeof(u8a_stream), u8a_buf, sizeof(u8a_buf), sa_many, 8, NULL), 5);
+    for (size_t i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(sa_many[i].i_status, COBS_FRAME_OK);
+        EXPECT_EQ(sa_many[i].s_size, sa_exp_size[i]);
+    }
+    EXPECT_EQ(memcmp(u8a_buf, u8a_exp, sizeof(u8a_exp)), 0);
+
+    ASSERT_TRUE(cobs_ring_init(&s_ring, u8a_buf, sizeof(u8a_buf)));
+    ASSERT_EQ(cobs_ring_write(&s_ring, u8a_stream, sizeof(u8a_stream)), sizeof(u8a_stream));
+    s_used = 0;
+    for (size_t i = 0; i < 5; i++)
+    {
+        ASSERT_TRUE(cobs_ring_read(&s_ring, u8a_out, sizeof(u8a_out), &s_size));
+        EXPECT_EQ(s_size, sa_exp_size[i]);
+        EXPECT_EQ(memcmp(u8a_out, u8a_exp + s_used, sa_exp_size[i]), 0);
+        s_used += sa_exp_size[i];
+    }
+
+    memset(&s_frames, 0, sizeof(s_frames));
+    sp_pool = cobs_pool_create(2, 1, 16, frames_collect_pool, &s_frames);
+    ASSERT_TRUE(sp_pool != NULL);
+    cobs_pool_push(sp_pool, 0, u8a_stream, sizeof(u8a_stream));
+    cobs_pool_destroy(sp_pool);
+    ASSERT_EQ(s_frames.s_frames, 5);
+    EXPECT_EQ(memcmp(s_frames.sa_size, sa_exp_size, sizeof(sa_exp_size)), 0);
+    EXPECT_EQ(memcmp(s_frames.u8a_data, u8a_exp, sizeof(u8a_exp)), 0);
+    for (size_t i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(s_frames.ia_status[i], COBS_FRAME_OK);
+    }
+}
+
+UTEST(cobs, encode_ref_random)
+{
+    static uint8_t u8a_data[2048];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(sizeof(u8a_data)) + 16];
+    static uint8_t u8a_code_exp[sizeof(u8a_code)];
+    const unsigned ua_zero_every[] = {0, 1, 2, 7, 40, 300};
+    const char *cp_kernel = cobs_kernel_name();
+
+    for (size_t n = 0; n < sizeof(cpa_kernels) / sizeof(cpa_kernels[0]); n++)
+    {
+        if (!cobs_kernel_set(cpa_kernels[n]))
+        {
+            continue;
+        }
+        for (int k = 0; k < 400; k++)
+        {
+            size_t s_size = (size_t)(rand() % sizeof(u8a_data));
+            size_t s_out_size = (k % 4 == 0) ? (size_t)(rand() % sizeof(u8a_code)) : sizeof(u8a_code);
+            memrand(u8a_data, s_size, ua_zero_every[k % 6]);
+            memset(u8a_code, 0xBB, sizeof(u8a_code));
+            memset(u8a_code_exp, 0xBB, sizeof(u8a_code_exp));
+            size_t s_exp = cobs_encode_ref(u8a_data, s_size, u8a_code_exp, s_out_size);
+            ASSERT_EQ(cobs_encode(u8a_data, s_size, u8a_code, s_out_size), s_exp);
+            if (s_exp != 0)
+            {
+                ASSERT_EQ(memcmp(u8a_code_exp, u8a_code, sizeof(u8a_code)), 0);
+            }
+        }
+    }
+    cobs_kernel_set(cp_kernel);
+}
+
+UTEST(cobs, decode_ref_random)
+{
+    static uint8_t u8a_data[2048];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(sizeof(u8a_data))];
+    static uint8_t u8a_data_out[sizeof(u8a_code)];
+    static uint8_t u8a_data_exp[sizeof(u8a_code)];
+    const unsigned ua_zero_every[] = {0, 1, 2, 7, 40, 300};
+    const char *cp_kernel = cobs_kernel_name();
+
+    for (size_t n = 0; n < sizeof(cpa_kernels) / sizeof(cpa_kernels[0]); n++)
+    {
+        if (!cobs_kernel_set(cpa_kernels[n]))
+        {
+            continue;
+        }
+        for (int k = 0; k < 2000; k++)
+        {
+            size_t s_size = (size_t)(rand() % sizeof(u8a_data));
+            memrand(u8a_data, s_size, ua_zero_every[k % 6]);
+            size_t s_code_size = cobs_encode(u8a_data, s_size, u8a_code, sizeof(u8a_code));
+            ASSERT_NE(s_code_size, 0);
+            switch (k % 5)
+            {
+            case 1:
+                /* Corrupt a byte. */
+                u8a_code[rand() % s_code_size] = (uint8_t)rand();
+                break;
+            case 2:
+                /* Insert an early frame end. */
+                u8a_code[rand() % s_code_size] = 0;
+                break;
+            case 3:
+                /* Truncate. */
+                s_code_size = 1 + (size_t)(rand() % s_code_size);
+                break;
+            case 4:
+                /* Garbage. */
+                memrand(u8a_code, s_code_size, ua_zero_every[rand() % 6]);
+                break;
+            default:
+                break;
+            }
+            size_t s_out_size = (k % 3 == 0) ? (size_t)(rand() % (s_size + 2)) : sizeof(u8a_data_out);
+            memset(u8a_data_out, 0xBB, sizeof(u8a_data_out));
+            memset(u8a_data_exp, 0xBB, sizeof(u8a_data_exp));
+            size_t s_exp = cobs_decode_ref(u8a_code, s_code_size, u8a_data_exp, s_out_size);
+            ASSERT_EQ(cobs_decode(u8a_code, s_code_size, u8a_data_out, s_out_size), s_exp);
+            if (s_exp != 0)
+            {
+                ASSERT_EQ(memcmp(u8a_data_exp, u8a_data_out, s_exp), 0);
+            }
+        }
+    }
+    cobs_kernel_set(cp_kernel);
+}
+
+UTEST(cobs, ref_run_lengths)
+{
+    static uint8_t u8a_data[1100];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(sizeof(u8a_data))];
+    static uint8_t u8a_code_exp[sizeof(u8a_code)];
+    static uint8_t u8a_data_out[sizeof(u8a_data)];
+    const char *cp_kernel = cobs_kernel_name();
+
+    for (size_t n = 0; n < sizeof(cpa_kernels) / sizeof(cpa_kernels[0]); n++)
+    {
+        if (!cobs_kernel_set(cpa_kernels[n]))
+        {
+            continue;
+        }
+        /* Runs around the vector widths and the 254 byte block limit. */
+        for (size_t s_run = 0; s_run < 530; s_run++)
+        {
+            for (size_t s_tail = 0; s_tail < 4; s_tail++)
+            {
+                size_t s_size = 2 * s_run + s_tail;
+                memset(u8a_data, 0x5A, s_size);
+                if (s_run < s_size)
+                {
+                    u8a_data[s_run] = 0;
+                }
+                memset(u8a_code, 0xBB, sizeof(u8a_code));
+                memset(u8a_code_exp, 0xBB, sizeof(u8a_code_exp));
+                size_t s_code_size = cobs_encode_ref(u8a_data, s_size, u8a_code_exp, sizeof(u8a_code_exp));
+                ASSERT_EQ(cobs_encode(u8a_data, s_size, u8a_code, sizeof(u8a_code)), s_code_size);
+                ASSERT_EQ(memcmp(u8a_code_exp, u8a_code, sizeof(u8a_code)), 0);
+                memset(u8a_data_out, 0xBB, sizeof(u8a_data_out));
+                ASSERT_EQ(cobs_decode(u8a_code, s_code_size, u8a_data_out, s_size), s_size);
+                ASSERT_EQ(memcmp(u8a_data, u8a_data_out, s_size), 0);
+                ASSERT_EQ(u8a_data_out[s_size], 0xBB);
+            }
+        }
+    }
+    cobs_kernel_set(cp_kernel);
+}
+
+UTEST(cobs, encoded_size)
+{
+    static uint8_t u8a_data[2048];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(sizeof(u8a_data))];
+    const unsigned ua_zero_every[] = {0, 1, 2, 7, 40, 300};
+    const char *cp_kernel = cobs_kernel_name();
+
+    EXPECT_EQ(cobs_encoded_size(u8a_data, 0), 2);
+    for (size_t n = 0; n < sizeof(cpa_kernels) / sizeof(cpa_kernels[0]); n++)
+    {
+        if (!cobs_kernel_set(cpa_kernels[n]))
+        {
+            continue;
+        }
+        /* All non-zero data is the worst case. */
+        memset(u8a_data, 0x11, sizeof(u8a_data));
+        for (size_t s_size = 0; s_size < sizeof(u8a_data); s_size++)
+        {
+            size_t s_code_size = cobs_encode(u8a_data, s_size, u8a_code, sizeof(u8a_code));
+            ASSERT_EQ(cobs_encoded_size(u8a_data, s_size), s_code_size);
+            ASSERT_LE(s_code_size, COBS_ENCODE_OUT_SIZE_MIN(s_size));
+        }
+        for (int k = 0; k < 300; k++)
+        {
+            size_t s_size = (size_t)(rand() % sizeof(u8a_data));
+            memrand(u8a_data, s_size, ua_zero_every[k % 6]);
+            ASSERT_EQ(cobs_encoded_size(u8a_data, s_size),
+                      cobs_encode(u8a_data, s_size, u8a_code, sizeof(u8a_code)));
+        }
+    }
+    cobs_kernel_set(cp_kernel);
+}
+
+UTEST(cobs, decoded_size)
+{
+    static uint8_t u8a_data[2048];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(sizeof(u8a_data))];
+    static uint8_t u8a_data_out[sizeof(u8a_data)];
+    const unsigned ua_zero_every[] = {0, 1, 2, 7, 40, 300};
+    const uint8_t u8a_truncated[] = {0x05, 0x11, 0x00};
+    const uint8_t u8a_no_end[] = {0x02, 0x11};
+    const uint8_t u8a_zero_code[] = {0x02, 0x11, 0x00, 0x11, 0x00};
+    const uint8_t u8a_empty[] = {0x01, 0x00};
+
+    EXPECT_EQ(cobs_decoded_size(u8a_truncated, sizeof(u8a_truncated)), COBS_SIZE_INVALID);
+    EXPECT_EQ(cobs_decoded_size(u8a_no_end, sizeof(u8a_no_end)), COBS_SIZE_INVALID);
+    EXPECT_EQ(cobs_decoded_size(u8a_zero_code, sizeof(u8a_zero_code)), COBS_SIZE_INVALID);
+    EXPECT_EQ(cobs_decoded_size(u8a_zero_code, 1), COBS_SIZE_INVALID);
+    EXPECT_EQ(cobs_decoded_size(u8a_empty, sizeof(u8a_empty)), 0);
+
+    /* Full block followed by an empty one. */
+    memset(u8a_code, 0x11, 256);
+    u8a_code[0] = 0xFF;
+    u8a_code[255] = 0x01;
+    u8a_code[256] = 0x00;
+    EXPECT_EQ(cobs_decoded_size(u8a_code, 257), 254);
+    EXPECT_EQ(cobs_decode(u8a_code, 257, u8a_data_out, sizeof(u8a_data_out)), 254);
+
+    for (int k = 0; k < 500; k++)
+    {
+        size_t s_size = (size_t)(rand() % sizeof(u8a_data));
+        memrand(u8a_data, s_size, ua_zero_every[k % 6]);
+        size_t s_code_size = cobs_encode(u8a_data, s_size, u8a_code, sizeof(u8a_code));
+        ASSERT_EQ(cobs_decoded_size(u8a_code, s_code_size), s_size);
+        ASSERT_EQ(cobs_decode(u8a_code, s_code_size, u8a_data_out, s_size), s_size);
+        /* Corrupt code bytes break the chain, corrupt data is not seen. */
+        u8a_code[rand() % s_code_size] = (uint8_t)rand();
+        size_t s_decoded_size = cobs_decoded_size(u8a_code, s_code_size);
+        if (s_decoded_size != COBS_SIZE_INVALID)
+        {
+            size_t s_decoded = cobs_decode(u8a_code, s_code_size, u8a_data_out, sizeof(u8a_data_out));
+            ASSERT_TRUE((s_decoded == s_decoded_size) || (s_decoded == 0));
+        }
+    }
+}
+
+UTEST(cobs, encoder_chunks)
+{
+    static uint8_t u8a_data[2048];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(sizeof(u8a_data))];
+    static uint8_t u8a_code_exp[sizeof(u8a_code)];
+    const unsigned ua_zero_every[] = {0, 1, 2, 7, 40, 300};
+    cobs_encoder_t s_enc;
+
+    /* Empty frame. */
+    cobs_encoder_begin(&s_enc, u8a_code, sizeof(u8a_code));
+    EXPECT_EQ(cobs_encoder_finish(&s_enc), 2);
+    EXPECT_EQ(u8a_code[0], 0x01);
+    EXPECT_EQ(u8a_code[1], 0x00);
+
+    for (int k = 0; k < 500; k++)
+    {
+        size_t s_size = (size_t)(rand() % sizeof(u8a_data));
+        size_t s_out_size = (k % 4 == 0) ? (size_t)(rand() % sizeof(u8a_code)) : sizeof(u8a_code);
+        memrand(u8a_data, s_size, ua_zero_every[k % 6]);
+        memset(u8a_code, 0xBB, sizeof(u8a_code));
+        memset(u8a_code_exp, 0xBB, sizeof(u8a_code_exp));
+        size_t s_exp = cobs_encode(u8a_data, s_size, u8a_code_exp, s_out_size);
+
+        cobs_encoder_begin(&s_enc, u8a_code, s_out_size);
+        size_t s_pos = 0;
+        while (s_pos < s_size)
+        {
+            size_t s_chunk = 1 + (size_t)(rand() % 300);
+            s_chunk = (s_chunk < (s_size - s_pos)) ? s_chunk : (s_size - s_pos);
+            size_t s_used = cobs_encoder_update(&s_enc, u8a_data + s_pos, s_chunk);
+            if (s_used != s_chunk)
+            {
+                ASSERT_EQ(s_exp, 0);
+                break;
+            }
+            s_pos += s_chunk;
+        }
+        ASSERT_EQ(cobs_encoder_finish(&s_enc), s_exp);
+        if (s_exp != 0)
+        {
+            ASSERT_EQ(memcmp(u8a_code_exp, u8a_code, sizeof(u8a_code)), 0);
+        }
+    }
+}
+
+UTEST(cobs, decoder_chunks)
+{
+    static uint8_t u8a_data[16 * 700];
+    static uint8_t u8a_code[16 * COBS_ENCODE_OUT_SIZE_MIN(700) + 16];
+    static uint8_t u8a_buf[600];
+    static frames_t s_frames;
+    const unsigned ua_zero_every[] = {0, 1, 2, 7, 40, 300};
+    size_t sa_size[16];
+    cobs_decoder_t s_dec;
+
+    for (int k = 0; k < 200; k++)
+    {
+        /* Stream of frames, the ones larger than the buffer are dropped. */
+        size_t s_frames_in = 1 + (size_t)(rand() % 16);
+        size_t s_data_size = 0;
+        size_t s_code_size = 0;
+        size_t s_dropped = 0;
+        for (size_t i = 0; i < s_frames_in; i++)
+        {
+            sa_size[i] = (size_t)(rand() % 700);
+            memrand(u8a_data + s_data_size, sa_size[i], ua_zero_every[rand() % 6]);
+            s_code_size += cobs_encode(u8a_data + s_data_size, sa_size[i],
+                                       u8a_code + s_code_size, sizeof(u8a_code) - s_code_size);
+            s_data_size += sa_size[i];
+            if ((k % 2) == 0)
+            {
+                /* Idle frame ends between frames. */
+                u8a_code[s_code_size++] = 0x00;
+            }
+        }
+
+        memset(&s_frames, 0, sizeof(s_frames));
+        cobs_decoder_init(&s_dec, u8a_buf, sizeof(u8a_buf), frames_collect, &s_frames);
+        size_t s_pos = 0;
+        size_t s_completed = 0;
+        while (s_pos < s_code_size)
+        {
+            size_t s_chunk = 1 + (size_t)(rand() % 100);
+            s_chunk = (s_chunk < (s_code_size - s_pos)) ? s_chunk : (s_code_size - s_pos);
+            s_completed += cobs_decoder_update(&s_dec, u8a_code + s_pos, s_chunk);
+            s_pos += s_chunk;
+        }
+
+        size_t s_frame = 0;
+        for (size_t i = 0; i < s_frames_in; i++)
+        {
+            if (sa_size[i] > sizeof(u8a_buf))
+            {
+                s_dropped++;
+            }
+            else
+            {
+                ASSERT_EQ(s_frames.sa_size[s_frame], sa_size[i]);
+                s_frame++;
+            }
+        }
+        ASSERT_EQ(s_frames.s_frames, s_frame);
+        ASSERT_EQ(s_completed, s_frame);
+        ASSERT_EQ(s_dec.s_frames_dropped, s_dropped);
+
+        /* Compare the payload of the frames that fit. */
+        size_t s_data_pos = 0;
+        size_t s_used = 0;
+        for (size_t i = 0; i < s_frames_in; i++)
+        {
+            if (sa_size[i] <= sizeof(u8a_buf))
+            {
+                ASSERT_EQ(memcmp(s_frames.u8a_data + s_used, u8a_data + s_data_pos, sa_size[i]), 0);
+                s_used += sa_size[i];
+            }
+            s_data_pos += sa_size[i];
+        }
+    }
+}
+
+UTEST(cobs, encode_many)
+{
+    static uint8_t u8a_data[64 * 100];
+    static uint8_t u8a_code[64 * COBS_ENCODE_OUT_SIZE_MIN(100)];
+    static uint8_t u8a_ref[COBS_ENCODE_OUT_SIZE_MIN(100)];
+    cobs_iovec_t sa_in[64];
+    size_t sa_offsets[64];
+    size_t s_out_size = 0;
+
+    for (size_t i = 0; i < 64; i++)
+    {
+        sa_in[i].vp_base = u8a_data + i * 100;
+        sa_in[i].s_len = (size_t)(rand() % 101);
+        memrand(sa_in[i].vp_base, sa_in[i].s_len, (unsigned)(i % 8));
+        s_out_size += COBS_ENCODE_OUT_SIZE_MIN(sa_in[i].s_len);
+    }
+    size_t s_size = cobs_encode_many(sa_in, 64, u8a_code, s_out_size, sa_offsets);
+    ASSERT_GT(s_size, 0);
+    for (size_t i = 0; i < 64; i++)
+    {
+        size_t s_ref_size = cobs_encode_ref(sa_in[i].vp_base, sa_in[i].s_len, u8a_ref, sizeof(u8a_ref));
+        size_t s_end = (i < 63) ? sa_offsets[i + 1] : s_size;
+        ASSERT_EQ(s_end - sa_offsets[i], s_ref_size);
+        ASSERT_EQ(memcmp(u8a_code + sa_offsets[i], u8a_ref, s_ref_size), 0);
+    }
+    EXPECT_EQ(cobs_encode_many(sa_in, 64, u8a_code, s_size - 1, NULL), 0);
+    EXPECT_EQ(cobs_encode_many(sa_in, 0, u8a_code, 0, NULL), 0);
+    /* The worst case size is checked before anything is written. */
+    memset(u8a_code, 0xBB, sizeof(u8a_code));
+    EXPECT_EQ(cobs_encode_many(sa_in, 64, u8a_code, s_out_size - 1, sa_offsets), 0);
+    for (size_t i = 0; i < s_out_size; i++)
+    {
+        ASSERT_EQ(u8a_code[i], 0xBB);
+    }
+}
+
+UTEST(cobs, encodev)
+{
+    static uint8_t u8a_data[2000];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(2000)];
+    static uint8_t u8a_ref[COBS_ENCODE_OUT_SIZE_MIN(2000)];
+    cobs_iovec_t sa_in[8];
+
+    for (int k = 0; k < 500; k++)
+    {
+        size_t s_size = (size_t)(rand() % 2000);
+        size_t s_count = 1 + (size_t)(rand() % 8);
+        size_t s_pos = 0;
+        memrand(u8a_data, s_size, (unsigned)(k % 5) * 50);
+        for (size_t i = 0; i < s_count; i++)
+        {
+            size_t s_len = (i < (s_count - 1)) ? (size_t)rand() % (s_size - s_pos + 1) : s_size - s_pos;
+            sa_in[i].vp_base = u8a_data + s_pos;
+            sa_in[i].s_len = s_len;
+            s_pos += s_len;
+        }
+        size_t s_ref_size = cobs_encode_ref(u8a_data, s_size, u8a_ref, sizeof(u8a_ref));
+        ASSERT_EQ(cobs_encodev(sa_in, s_count, u8a_code, sizeof(u8a_code)), s_ref_size);
+        ASSERT_EQ(memcmp(u8a_code, u8a_ref, s_ref_size), 0);
+        ASSERT_EQ(cobs_encodev(sa_in, s_count, u8a_code, s_ref_size - 1), 0);
+    }
+}
+
+UTEST(cobs, decodev)
+{
+    static uint8_t u8a_data[2000];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(2000)];
+    static uint8_t u8a_out[2000 + 8];
+    static uint8_t u8a_ref[2000];
+    cobs_iovec_t sa_out[8];
+
+    for (int k = 0; k < 500; k++)
+    {
+        size_t s_size = (size_t)(rand() % 2000);
+        size_t s_count = 1 + (size_t)(rand() % 8);
+        size_t s_out_size = s_size + (size_t)(k % 2);
+        size_t s_pos = 0;
+        memrand(u8a_data, s_size, (unsigned)(k % 5) * 50);
+        size_t s_code_size = cobs_encode(u8a_data, s_size, u8a_code, sizeof(u8a_code));
+        for (size_t i = 0; i < s_count; i++)
+        {
+            size_t s_len = (i < (s_count - 1)) ? (size_t)rand() % (s_out_size - s_pos + 1) : s_out_size - s_pos;
+            sa_out[i].vp_base = u8a_out + s_pos + i;
+            sa_out[i].s_len = s_len;
+            s_pos += s_len;
+        }
+        size_t s_ref_size = cobs_decode_ref(u8a_code, s_code_size, u8a_ref, s_out_size);
+        ASSERT_EQ(cobs_decodev(u8a_code, s_code_size, sa_out, s_count), s_ref_size);
+        s_pos = 0;
+        for (size_t i = 0; (i < s_count) && (s_pos < s_ref_size); i++)
+        {
+            size_t s_len = (sa_out[i].s_len < (s_ref_size - s_pos)) ? sa_out[i].s_len : s_ref_size - s_pos;
+            ASSERT_EQ(memcmp(sa_out[i].vp_base, u8a_ref + s_pos, s_len), 0);
+            s_pos += s_len;
+        }
+        if ((s_size > 0) && (sa_out[s_count - 1].s_len > (size_t)(k % 2)))
+        {
+            /* One byte short. */
+            sa_out[s_count - 1].s_len -= (size_t)(k % 2) + 1;
+            ASSERT_EQ(cobs_decodev(u8a_code, s_code_size, sa_out, s_count),
+                      cobs_decode_ref(u8a_code, s_code_size, u8a_ref, s_size - 1));
+        }
+    }
+}
+
+UTEST(cobs, cobs_r)
+{
+    static uint8_t u8a_data[1000];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(1000)];
+    static uint8_t u8a_plain[COBS_ENCODE_OUT_SIZE_MIN(1000)];
+    static uint8_t u8a_out[1000];
+    const uint8_t u8a_in[][4] = {{0x02}, {0x01}, {0x11, 0x22, 0x00, 0x33},
+                                 {0x11, 0x22, 0x33, 0x44}, {0x11, 0x00, 0x00, 0x00}};
+    const size_t sa_in_size[] = {1, 1, 4, 4, 4};
+    const uint8_t u8a_exp[][6] = {{0x02, 0x00},
+                                  {0x02, 0x01, 0x00},
+                                  {0x03, 0x11, 0x22, 0x33, 0x00},
+                                  {0x44, 0x11, 0x22, 0x33, 0x00},
+                                  {0x02, 0x11, 0x01, 0x01, 0x01, 0x00}};
+    const size_t sa_exp_size[] = {2, 3, 5, 5, 6};
+    uint8_t u8a_ff[256];
+    const char *cp_kernel = cobs_kernel_name();
+
+    EXPECT_EQ(cobs_r_encode(u8a_data, 0, u8a_code, sizeof(u8a_code)), 2U);
+    EXPECT_EQ(u8a_code[0], 0x01);
+    EXPECT_EQ(cobs_r_decode(u8a_code, 2, u8a_out, sizeof(u8a_out)), 0U);
+    for (size_t i = 0; i < sizeof(sa_in_size) / sizeof(sa_in_size[0]); i++)
+    {
+        ASSERT_EQ(cobs_r_encode(u8a_in[i], sa_in_size[i], u8a_code, sizeof(u8a_code)), sa_exp_size[i]);
+        EXPECT_EQ(memcmp(u8a_code, u8a_exp[i], sa_exp_size[i]), 0);
+        ASSERT_EQ(cobs_r_decode(u8a_code, sa_exp_size[i], u8a_out, COBS_R_DECODE_OUT_SIZE_MIN(sa_exp_size[i])),
+                  sa_in_size[i]);
+        EXPECT_EQ(memcmp(u8a_out, u8a_in[i], sa_in_size[i]), 0);
+    }
+    /* Reduced full block, the code byte is the only data byte left. */
+    memset(u8a_ff, 0xFF, sizeof(u8a_ff));
+    ASSERT_EQ(cobs_r_encode(u8a_ff, 254, u8a_code, sizeof(u8a_code)), 255U);
+    ASSERT_EQ(cobs_r_decode(u8a_code, 255, u8a_out, 254), 254U);
+    EXPECT_EQ(memcmp(u8a_out, u8a_ff, 254), 0);
+    ASSERT_EQ(cobs_r_decode(u8a_code, 255, u8a_out, 253), 0U);
+
+    for (size_t j = 0; j < sizeof(cpa_kernels) / sizeof(cpa_kernels[0]); j++)
+    {
+        if (!cobs_kernel_set(cpa_kernels[j]))
+        {
+            continue;
+        }
+        for (int k = 0; k < 500; k++)
+        {
+            size_t s_size = (size_t)(rand() % 1000);
+            memrand(u8a_data, s_size, (unsigned)(k % 6) * 60);
+            size_t s_plain_size = cobs_encode(u8a_data, s_size, u8a_plain, sizeof(u8a_plain));
+            size_t s_code_size = cobs_r_encode(u8a_data, s_size, u8a_code, sizeof(u8a_code));
+            ASSERT_GE(s_code_size + 1U, s_plain_size);
+            ASSERT_LE(s_code_size, s_plain_size);
+            ASSERT_EQ(memchr(u8a_code, 0, s_code_size - 1U), NULL);
+            ASSERT_EQ(cobs_r_decode(u8a_code, s_code_size, u8a_out, s_size), s_size);
+            ASSERT_EQ(memcmp(u8a_out, u8a_data, s_size), 0);
+            /* Plain frames still decode. */
+            ASSERT_EQ(cobs_r_decode(u8a_plain, s_plain_size, u8a_out, s_size), s_size);
+            ASSERT_EQ(memcmp(u8a_out, u8a_data, s_size), 0);
+            if (s_size > 0U)
+            {
+                ASSERT_EQ(cobs_r_decode(u8a_code, s_code_size, u8a_out, s_size - 1U), 0U);
+            }
+        }
+    }
+    cobs_kernel_set(cp_kernel);
+}
+
+UTEST(cobs, zpe_encode555zeros)
+{
+    uint8_t u8a_data_mem[1024];
+    uint8_t u8a_code_mem[1024];
+    uint8_t u8a_data_mem_exp[1024];
+    uint8_t u8a_code_mem_exp[1024];
+    uint8_t u8a_data[555] = {0};
+    uint8_t u8a_code[279] = {0};
+
+    for (int i = 0; i < (sizeof(u8a_code) - 1); i++)
+    {
+        u8a_code[i] = 0xE1;
+    }
+
+    memset(u8a_data_mem, 0xAA, sizeof(u8a_data_mem));
+    memset(u8a_code_mem, 0xBB, sizeof(u8a_code_mem));
+    memcpy(u8a_data_mem_exp, u8a_data_mem, sizeof(u8a_data_mem));
+    memcpy(u8a_data_mem_exp, u8a_data, sizeof(u8a_data));
+    memcpy(u8a_code_mem_exp, u8a_code_mem, sizeof(u8a_code_mem));
+    memcpy(u8a_code_mem_exp, u8a_code, sizeof(u8a_code));
+
+    EXPECT_EQ(cobs_zpe_encode(u8a_data, sizeof(u8a_data), u8a_code_mem, sizeof(u8a_code)), sizeof(u8a_code));
+    EXPECT_EQ(memcmp(u8a_code_mem_exp, u8a_code_mem, sizeof(u8a_code_mem)), 0);
+    EXPECT_EQ(cobs_zpe_decode(u8a_code, sizeof(u8a_code), u8a_data_mem, sizeof(u8a_data)), sizeof(u8a_data));
+    EXPECT_EQ(memcmp(u8a_data_mem_exp, u8a_data_mem, sizeof(u8a_code_mem)), 0);
+}
+
+UTEST(cobs, zpe_encode554zeros)
+{
+    uint8_t u8a_data_mem[1024];
+    uint8_t u8a_code_mem[1024];
+    uint8_t u8a_data_mem_exp[1024];
+    uint8_t u8a_code_mem_exp[1024];
+    uint8_t u8a_data[554] = {0};
+    uint8_t u8a_code[279] = {0};
+
+    for (int i = 0; i < (sizeof(u8a_code) - 2); i++)
+    {
+        u8a_code[i] = 0xE1;
+    }
+    u8a_code[277] = 0x01;
+
+    memset(u8a_data_mem, 0xAA, sizeof(u8a_data_mem));
+    memset(u8a_code_mem, 0xBB, sizeof(u8a_code_mem));
+    memcpy(u8a_data_mem_exp, u8a_data_mem, sizeof(u8a_data_mem));
+    memcpy(u8a_data_mem_exp, u8a_data, sizeof(u8a_data));
+    memcpy(u8a_code_mem_exp, u8a_code_mem, sizeof(u8a_code_mem));
+    memcpy(u8a_code_mem_exp, u8a_code, sizeof(u8a_code));
+
+    EXPECT_EQ(cobs_zpe_encode(u8a_data, sizeof(u8a_data), u8a_code_mem, sizeof(u8a_code)), sizeof(u8a_code));
+    EXPECT_EQ(memcmp(u8a_code_mem_exp, u8a_code_mem, sizeof(u8a_code_mem)), 0);
+    EXPECT_EQ(cobs_zpe_decode(u8a_code, sizeof(u8a_code), u8a_data_mem, sizeof(u8a_data)), sizeof(u8a_data));
+    EXPECT_EQ(memcmp(u8a_data_mem_exp, u8a_data_mem, sizeof(u8a_code_mem)), 0);
+}
+
+UTEST(cobs, zpe_encode555ones)
+{
+    uint8_t u8a_data_mem[1024];
+    uint8_t u8a_code_mem[1024];
+    uint8_t u8a_data_mem_exp[1024];
+    uint8_t u8a_code_mem_exp[1024];
+    uint8_t u8a_data[555] = {0};
+    uint8_t u8a_code[559] = {0};
+
+    memset(u8a_data, 1, sizeof(u8a_data));
+    memset(u8a_code, 1, sizeof(u8a_code));
+    u8a_code[0] = 0xE0;
+    u8a_code[224] = 0xE0;
+    u8a_code[448] = 110;
+    u8a_code[558] = 0;
+
+    memset(u8a_data_mem, 0xAA, sizeof(u8a_data_mem));
+    memset(u8a_code_mem, 0xBB, sizeof(u8a_code_mem));
+    memcpy(u8a_data_mem_exp, u8a_data_mem, sizeof(u8a_data_mem));
+    memcpy(u8a_data_mem_exp, u8a_data, sizeof(u8a_data));
+    memcpy(u8a_code_mem_exp, u8a_code_mem, sizeof(u8a_code_mem));
+    memcpy(u8a_code_mem_exp, u8a_code, sizeof(u8a_code));
+
+    EXPECT_EQ(cobs_zpe_encode(u8a_data, sizeof(u8a_data), u8a_code_mem, sizeof(u8a_code)), sizeof(u8a_code));
+    EXPECT_EQ(memcmp(u8a_code_mem_exp, u8a_code_mem, sizeof(u8a_code_mem)), 0);
+    EXPECT_EQ(cobs_zpe_decode(u8a_code, sizeof(u8a_code), u8a_data_mem, sizeof(u8a_data)), sizeof(u8a_data));
+    EXPECT_EQ(memcmp(u8a_data_mem_exp, u8a_data_mem, sizeof(u8a_code_mem)), 0);
+}
+
+UTEST(cobs, zpe)
+{
+    static uint8_t u8a_data[1000];
+    static uint8_t u8a_code[COBS_ZPE_ENCODE_OUT_SIZE_MIN(1000)];
+    static uint8_t u8a_out[1000];
+    const uint8_t u8a_in[] = {0x11, 0x00, 0x00, 0x22, 0x00};
+    const uint8_t u8a_exp[] = {0xE2, 0x11, 0xE2, 0x22, 0x00};
+    const uint8_t u8a_pairs[] = {0xE1, 0xE1, 0x00};
+    const uint8_t u8a_invalid[][4] = {{0xE3, 0x11, 0x00, 0x00},
+                                      {0x02, 0x00, 0x11, 0x00},
+                                      {0x02, 0x11, 0x03, 0x22}};
+    const char *cp_kernel = cobs_kernel_name();
+
+    ASSERT_EQ(cobs_zpe_encode(u8a_in, sizeof(u8a_in), u8a_code, sizeof(u8a_code)), sizeof(u8a_exp));
+    EXPECT_EQ(memcmp(u8a_code, u8a_exp, sizeof(u8a_exp)), 0);
+    EXPECT_EQ(cobs_zpe_encode(u8a_in, sizeof(u8a_in), u8a_code, sizeof(u8a_exp) - 1U), 0U);
+    EXPECT_EQ(cobs_zpe_encode(u8a_in, 0, u8a_code, sizeof(u8a_code)), 2U);
+    EXPECT_EQ(u8a_code[0], 0x01);
+    EXPECT_EQ(cobs_zpe_decode(u8a_pairs, sizeof(u8a_pairs), u8a_out, COBS_ZPE_DECODE_OUT_SIZE_MIN(sizeof(u8a_pairs))), 3U);
+    EXPECT_EQ(cobs_zpe_decode(u8a_pairs, sizeof(u8a_pairs), u8a_out, 2U), 0U);
+    for (size_t i = 0; i < sizeof(u8a_invalid) / sizeof(u8a_invalid[0]); i++)
+    {
+        EXPECT_EQ(cobs_zpe_decode(u8a_invalid[i], sizeof(u8a_invalid[i]), u8a_out, sizeof(u8a_out)), 0U);
+    }
+
+    for (size_t j = 0; j < sizeof(cpa_kernels) / sizeof(cpa_kernels[0]); j++)
+    {
+        if (!cobs_kernel_set(cpa_kernels[j]))
+        {
+            continue;
+        }
+        for (int k = 0; k < 500; k++)
+        {
+            size_t s_size = (size_t)(rand() % 1000);
+            memrand(u8a_data, s_size, (unsigned)(k % 6) * 60);
+            if ((k % 3) == 0)
+            {
+                /* Zero padded fields. */
+                for (size_t i = 0; i < s_size; i += 8U)
+                {
+                    memset(&u8a_data[i], 0, ((s_size - i) < 4U) ? (s_size - i) : 4U);
+                }
+            }
+            size_t s_code_size = cobs_zpe_encode(u8a_data, s_size, u8a_code, COBS_ZPE_ENCODE_OUT_SIZE_MIN(s_size));
+            ASSERT_GT(s_code_size, 0U);
+            ASSERT_EQ(memchr(u8a_code, 0, s_code_size - 1U), NULL);
+            ASSERT_EQ(u8a_code[s_code_size - 1U], 0);
+            ASSERT_EQ(cobs_zpe_encode(u8a_data, s_size, u8a_code, s_code_size - 1U), 0U);
+            ASSERT_EQ(cobs_zpe_decode(u8a_code, s_code_size, u8a_out, s_size), s_size);
+            ASSERT_EQ(memcmp(u8a_out, u8a_data, s_size), 0);
+            if (s_size > 0U)
+            {
+                ASSERT_EQ(cobs_zpe_decode(u8a_code, s_code_size, u8a_out, s_size - 1U), 0U);
+            }
+        }
+    }
+    cobs_kernel_set(cp_kernel);
+}
+
+UTEST(cobs, delim)
+{
+    static uint8_t u8a_data[1000];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(1000)];
+    static uint8_t u8a_ref[COBS_ENCODE_OUT_SIZE_MIN(1000)];
+    static uint8_t u8a_out[1000];
+    static uint8_t u8a_out_ref[1000];
+
+    for (int k = 0; k < 1000; k++)
+    {
+        uint8_t u8_delim = (uint8_t)(rand() % 256);
+        size_t s_size = (size_t)(rand() % 1000);
+        memrand(u8a_data, s_size, (unsigned)(k % 6) * 60);
+        size_t s_ref_size = cobs_encode(u8a_data, s_size, u8a_ref, sizeof(u8a_ref));
+        for (size_t i = 0; i < s_ref_size; i++)
+        {
+            u8a_ref[i] ^= u8_delim;
+        }
+        ASSERT_EQ(cobs_encode_delim(u8a_data, s_size, u8a_code, sizeof(u8a_code), u8_delim), s_ref_size);
+        ASSERT_EQ(memcmp(u8a_code, u8a_ref, s_ref_size), 0);
+        ASSERT_EQ(memchr(u8a_code, u8_delim, s_ref_size - 1U), NULL);
+        ASSERT_EQ(cobs_encode_delim(u8a_data, s_size, u8a_code, s_ref_size - 1U, u8_delim), 0U);
+        ASSERT_EQ(cobs_decode_delim(u8a_code, s_ref_size, u8a_out, s_size, u8_delim), s_size);
+        ASSERT_EQ(memcmp(u8a_out, u8a_data, s_size), 0);
+        if ((k % 4) == 0)
+        {
+            /* Early frame end or damaged frame, same result as decoding the XORed frame. */
+            size_t s_code_size = (size_t)rand() % (s_ref_size + 1);
+            if ((k % 8) == 0)
+            {
+                u8a_code[(size_t)rand() % s_ref_size] = u8_delim;
+            }
+            memcpy(u8a_ref, u8a_code, s_code_size);
+            for (size_t i = 0; i < s_code_size; i++)
+            {
+                u8a_ref[i] ^= u8_delim;
+            }
+            size_t s_out_ref = cobs_decode(u8a_ref, s_code_size, u8a_out_ref, sizeof(u8a_out_ref));
+            ASSERT_EQ(cobs_decode_delim(u8a_code, s_code_size, u8a_out, sizeof(u8a_out), u8_delim), s_out_ref);
+            ASSERT_EQ(memcmp(u8a_out, u8a_out_ref, s_out_ref), 0);
+        }
+    }
+}
+
+UTEST(cobs, encode_commit)
+{
+    static uint8_t u8a_data[1000];
+    static uint8_t u8a_buf[COBS_ENCODE_OUT_SIZE_MIN(1000)];
+    static uint8_t u8a_ref[COBS_ENCODE_OUT_SIZE_MIN(1000)];
+    const char *cp_kernel = cobs_kernel_name();
+
+    for (size_t j = 0; j < sizeof(cpa_kernels) / sizeof(cpa_kernels[0]); j++)
+    {
+        if (!cobs_kernel_set(cpa_kernels[j]))
+        {
+            continue;
+        }
+        for (int k = 0; k < 300; k++)
+        {
+            size_t s_max = (size_t)(rand() % 1000);
+            size_t s_size = ((k % 2) == 0) ? s_max : (size_t)rand() % (s_max + 1);
+            size_t s_buf_size = COBS_ENCODE_OUT_SIZE_MIN(s_max);
+            memrand(u8a_data, s_size, (unsigned)(k % 3) * 127);
+            uint8_t *u8p_payload = cobs_encode_reserve(u8a_buf, s_buf_size, s_max);
+            ASSERT_TRUE(u8p_payload == u8a_buf + COBS_ENCODE_HEADROOM(s_max));
+            memcpy(u8p_payload, u8a_data, s_size);
+            size_t s_ref_size = cobs_encode_ref(u8a_data, s_size, u8a_ref, sizeof(u8a_ref));
+            ASSERT_EQ(cobs_encode_commit(u8a_buf, s_buf_size, s_max, s_size), s_ref_size);
+            ASSERT_EQ(memcmp(u8a_buf, u8a_ref, s_ref_size), 0);
+        }
+    }
+    cobs_kernel_set(cp_kernel);
+    EXPECT_TRUE(cobs_encode_reserve(u8a_buf, COBS_ENCODE_OUT_SIZE_MIN(508) - 1, 508) == NULL);
+    EXPECT_EQ(cobs_encode_commit(u8a_buf, sizeof(u8a_buf), 10, 11), 0);
+}
+
+UTEST(cobs, decode_inplace)
+{
+    static uint8_t u8a_data[1000];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(1000)];
+    static uint8_t u8a_buf[COBS_ENCODE_OUT_SIZE_MIN(1000)];
+    static uint8_t u8a_ref[1000];
+    const char *cp_kernel = cobs_kernel_name();
+
+    for (size_t j = 0; j < sizeof(cpa_kernels) / sizeof(cpa_kernels[0]); j++)
+    {
+        if (!cobs_kernel_set(cpa_kernels[j]))
+        {
+            continue;
+        }
+        for (int k = 0; k < 300; k++)
+        {
+            size_t s_size = (size_t)(rand() % 1000);
+            memrand(u8a_data, s_size, (unsigned)(k % 6) * 60);
+            size_t s_code_size = cobs_encode(u8a_data, s_size, u8a_code, sizeof(u8a_code));
+            if ((k % 4) == 0)
+            {
+                /* Early frame end. */
+                s_code_size = (size_t)rand() % (s_code_size + 1);
+            }
+            memcpy(u8a_buf, u8a_code, s_code_size);
+            size_t s_ref_size = cobs_decode_ref(u8a_code, s_code_size, u8a_ref, sizeof(u8a_ref));
+            ASSERT_EQ(cobs_decode_inplace(u8a_buf, s_code_size), s_ref_size);
+            ASSERT_EQ(memcmp(u8a_buf, u8a_ref, s_ref_size), 0);
+        }
+    }
+    cobs_kernel_set(cp_kernel);
+}
+
+UTEST(cobs, view)
+{
+    static uint8_t u8a_data[2000];
+    static uint8_t u8a_code[COBS_ENCODE_OUT_SIZE_MIN(2000)];
+    static uint8_t u8a_out[2000];
+    const uint8_t u8a_invalid[][4] = {{0x05, 0x11, 0x00, 0x00},
+                                      {0x02, 0x00, 0x11, 0x00},
+                                      {0x01, 0x01, 0x11, 0x00},
+                                      {0x00, 0x11, 0x11, 0x00}};
+    const uint8_t u8a_empty[] = {0x01, 0x00};
+    cobs_view_t s_view;
+    cobs_segment_t s_seg;
+
+    for (int k = 0; k < 500; k++)
+    {
+        size_t s_size = (size_t)(rand() % 2000);
+        memrand(u8a_data, s_size, (unsigned)(k % 6) * 60);
+        size_t s_code_size = cobs_encode(u8a_data, s_size, u8a_code, sizeof(u8a_code));
+        ASSERT_TRUE(cobs_view_init(&s_view, u8a_code, s_code_size));
+        ASSERT_EQ(s_view.s_size, s_size);
+        size_t s_pos = 0;
+        while (cobs_view_next(&s_view, &s_seg))
+        {
+            ASSERT_LE(s_pos + s_seg.s_size + (size_t)s_seg.i_zero, s_size);
+            memcpy(u8a_out + s_pos, s_seg.u8p_data, s_seg.s_size);
+            s_pos += s_seg.s_size;
+            if (s_seg.i_zero)
+            {
+                u8a_out[s_pos++] = 0x00;
+            }
+        }
+        ASSERT_EQ(s_pos, s_size);
+        ASSERT_EQ(memcmp(u8a_out, u8a_data, s_size), 0);
+    }
+
+    for (size_t i = 0; i < sizeof(u8a_invalid) / sizeof(u8a_invalid[0]); i++)
+    {
+        EXPECT_FALSE(cobs_view_init(&s_view, u8a_invalid[i], sizeof(u8a_invalid[i])));
+        EXPECT_FALSE(cobs_view_next(&s_view, &s_seg));
+    }
+    EXPECT_TRUE(cobs_view_init(&s_view, u8a_empty, sizeof(u8a_empty)));
+    EXPECT_TRUE(cobs_view_next(&s_view, &s_seg));
+    EXPECT_EQ(s_seg.s_size, 0);
+    EXPECT_FALSE(s_seg.i_zero);
+    EXPECT_FALSE(cobs_view_next(&s_view, &s_seg));
+}
+
+UTEST(cobs, decode_many)
+{
+    static uint8_t u8a_data[16 * 300];
+    static uint8_t u8a_code[16 * COBS_ENCODE_OUT_SIZE_MIN(300) + 32];
+    static uint8_t u8a_out[sizeof(u8a_code)];
+    const unsigned ua_zero_every[] = {0, 1, 2, 7, 40, 300};
+    const uint8_t u8a_mixed[] = {0x00, 0x03, 0x11, 0x22, 0x00, 0x05, 0x11, 0x00,
+                                 0x00, 0x01, 0x00, 0x02, 0x33, 0x00, 0x02};
+    size_t sa_size[16];
+    cobs_frame_t sa_frames[16];
+    size_t s_code_size;
+    size_t s_in_used;
+
+    for (int k = 0; k < 300; k++)
+    {
+        size_t s_frames_in = 1 + (size_t)(rand() % 20);
+        size_t s_data_size = 0;
+        s_code_size = 0;
+        for (size_t i = 0; i < s_frames_in; i++)
+        {
+            size_t s_size = (size_t)(rand() % 300);
+            memrand(u8a_data + s_data_size, s_size, ua_zero_every[rand() % 6]);
+            s_code_size += cobs_encode(u8a_data + s_data_size, s_size,
+                                       u8a_code + s_code_size, sizeof(u8a_code) - s_code_size);
+            if ((k % 3) == 0)
+            {
+                u8a_code[s_code_size++] = 0x00;
+            }
+            if (i < 16)
+            {
+                sa_size[i] = s_size;
+                s_data_size += s_size;
+            }
+        }
+        /* Trailing partial frame. */
+        u8a_code[s_code_size] = 0x05;
+        u8a_code[s_code_size + 1] = 0x11;
+
+        size_t s_frames = cobs_decode_many(u8a_code, s_code_size + 2, u8a_out, sizeof(u8a_out),
+                                           sa_frames, 16, &s_in_used);
+        ASSERT_EQ(s_frames, (s_frames_in < 16) ? s_frames_in : 16);
+        if (s_frames_in < 16)
+        {
+            ASSERT_EQ(s_in_used, s_code_size);
+        }
+        s_data_size = 0;
+        for (size_t i = 0; i < s_frames; i++)
+        {
+            ASSERT_EQ(sa_frames[i].i_status, COBS_FRAME_OK);
+            ASSERT_EQ(sa_frames[i].s_offset, s_data_size);
+            ASSERT_EQ(sa_frames[i].s_size, sa_size[i]);
+            s_data_size += sa_size[i];
+        }
+        ASSERT_EQ(memcmp(u8a_out, u8a_data, s_data_size), 0);
+    }
+
+    /* Idle frame ends, a truncated code chain and a trailing partial frame. */
+    EXPECT_EQ(cobs_decode_many(u8a_mixed, sizeof(u8a_mixed), u8a_out, sizeof(u8a_out),
+                               sa_frames, 16, &s_in_used), 4);
+    EXPECT_EQ(s_in_used, sizeof(u8a_mixed) - 1);
+    EXPECT_EQ(sa_frames[0].i_status, COBS_FRAME_OK);
+    EXPECT_EQ(sa_frames[0].s_size, 2);
+    EXPECT_EQ(sa_frames[1].i_status, COBS_FRAME_OK);
+    EXPECT_EQ(sa_frames[1].s_size, 1);
+    EXPECT_EQ(sa_frames[2].i_status, COBS_FRAME_OK);
+    EXPECT_EQ(sa_frames[2].s_size, 0);
+    EXPECT_EQ(sa_frames[3].i_status, COBS_FRAME_OK);
+    EXPECT_EQ(sa_frames[3].s_offset, 3);
+    EXPECT_EQ(sa_frames[3].s_size, 1);
+    EXPECT_EQ(memcmp(u8a_out, "\x11\x22\x11\x33", 4), 0);
+
+    /* Output too small for the second frame, it is left for the next call. */
+    memset(u8a_data, 0x11, 100);
+    s_code_size = cobs_encode(u8a_data, 100, u8a_code, sizeof(u8a_code));
+    s_code_size += cobs_encode(u8a_data, 100, u8a_code + s_code_size, sizeof(u8a_code) - s_code_size);
+    EXPECT_EQ(cobs_decode_many(u8a_code, s_code_size, u8a_out, 150, sa_frames, 16, &s_in_used), 1);
+    EXPECT_EQ(s_in_used, s_code_size / 2);
+    EXPECT_EQ(sa_frames[0].s_size, 100);
+}
+
+UTEST(cobs, encode_parallel)
+{
+    const size_t s_size_max = 8 * COBS_MT_CHUNK_MIN + 1000;
+    const unsigned ua_zero_every[] = {0, 1, 7, 254, 300, 5000, 200000};
+    uint8_t *u8p_data = malloc(s_size_max);
+    uint8_t *u8p_code = malloc(COBS_ENCODE_OUT_SIZE_MIN(s_size_max));
+    uint8_t *u8p_ref = malloc(COBS_ENCODE_OUT_SIZE_MIN(s_size_max));
+    ASSERT_TRUE((u8p_data != NULL) && (u8p_code != NULL) && (u8p_ref != NULL));
+
+    for (int k = 0; k < 28; k++)
+    {
+        size_t s_size = s_size_max - (size_t)(rand() % 3000);
+        unsigned u_threads = 1 + (unsigned)(k % 9);
+        memrand(u8p_data, s_size, ua_zero_every[k % 7]);
+        if ((k % 7) == 0)
+        {
+            /* Zero only at a few places, near the even split. */
+            u8p_data[s_size / 2 - 1 - (size_t)(rand() % 300)] = 0x00;
+            u8p_data[s_size / 4 + (size_t)(rand() % 300)] = 0x00;
+        }
+        size_t s_ref_size = cobs_encode(u8p_data, s_size, u8p_ref, COBS_ENCODE_OUT_SIZE_MIN(s_size));
+        ASSERT_EQ(cobs_encode_parallel(u8p_data, s_size, u8p_code, COBS_ENCODE_OUT_SIZE_MIN(s_size), u_threads),
+                  s_ref_size);
+        ASSERT_EQ(memcmp(u8p_code, u8p_ref, s_ref_size), 0);
+        ASSERT_EQ(cobs_encode_parallel(u8p_data, s_size, u8p_code, s_ref_size - 1, u_threads), 0);
+    }
+    free(u8p_data);
+    free(u8p_code);
+    free(u8p_ref);
+}
+
+UTEST(cobs, decode_parallel)
+{
+    const size_t s_size_max = 8 * COBS_MT_CHUNK_MIN + 1000;
+    const unsigned ua_zero_every[] = {0, 1, 7, 254, 300, 5000, 200000};
+    uint8_t *u8p_data = malloc(s_size_max);
+    uint8_t *u8p_code = malloc(COBS_ENCODE_OUT_SIZE_MIN(s_size_max));
+    uint8_t *u8p_out = malloc(s_size_max);
+    uint8_t *u8p_ref = malloc(s_size_max);
+    ASSERT_TRUE((u8p_data != NULL) && (u8p_code != NULL) && (u8p_out != NULL) && (u8p_ref != NULL));
+
+    for (int k = 0; k < 28; k++)
+    {
+        size_t s_size = s_size_max - (size_t)(rand() % 3000);
+        unsigned u_threads = 1 + (unsigned)(k % 9);
+        memrand(u8p_data, s_size, ua_zero_every[k % 7]);
+        size_t s_code_size = cobs_encode(u8p_data, s_size, u8p_code, COBS_ENCODE_OUT_SIZE_MIN(s_size));
+        ASSERT_EQ(cobs_decode_parallel(u8p_code, s_code_size, u8p_out, s_size, u_threads), s_size);
+        ASSERT_EQ(memcmp(u8p_out, u8p_data, s_size), 0);
+        ASSERT_EQ(cobs_decode_parallel(u8p_code, s_code_size, u8p_out, s_size - 1, u_threads), 0);
+
+        /* Corrupt and truncated frames decode as with cobs_decode(). */
+        size_t s_pos = (size_t)rand() % s_code_size;
+        u8p_code[s_pos] = (uint8_t)(((k % 2) == 0) ? 0x00 : 0x01 + rand() % 255);
+        if ((k % 4) == 1)
+        {
+            u8p_code[s_code_size - 2] = 0x00;
+        }
+        size_t s_ref_size = cobs_decode(u8p_code, s_code_size, u8p_ref, s_size);
+        ASSERT_EQ(cobs_decode_parallel(u8p_code, s_code_size, u8p_out, s_size, u_threads), s_ref_size);
+        ASSERT_EQ(memcmp(u8p_out, u8p_ref, s_ref_size), 0);
+    }
+
+    /* Empty last block behind a full block needs one more byte of output. */
+    memrand(u8p_data, 254 * 2000, 0);
+    size_t s_code_size = cobs_encode(u8p_data, 254 * 2000, u8p_code, COBS_ENCODE_OUT_SIZE_MIN(254 * 2000));
+    u8p_code[s_code_size - 1] = 0x01;
+    u8p_code[s_code_size] = 0x00;
+    EXPECT_EQ(cobs_decode(u8p_code, s_code_size + 1, u8p_out, 254 * 2000), 0);
+    EXPECT_EQ(cobs_decode_parallel(u8p_code, s_code_size + 1, u8p_out, 254 * 2000, 4), 0);
+    EXPECT_EQ(cobs_decode_parallel(u8p_code, s_code_size + 1, u8p_out, 254 * 2000 + 1, 4), 254 * 2000);
+    free(u8p_data);
+    free(u8p_code);
+    free(u8p_out);
+    free(u8p_ref);
+
+    /* All threads, size not a multiple of the thread count. */
+    const size_t s_size_all = COBS_MT_THREADS_MAX * COBS_MT_CHUNK_MIN + 100;
+    u8p_data = calloc(s_size_all, 1);
+    u8p_code = malloc(COBS_ENCODE_OUT_SIZE_MIN(s_size_all));
+    u8p_out = malloc(s_size_all);
+    ASSERT_TRUE((u8p_data != NULL) && (u8p_code != NULL) && (u8p_out != NULL));
+    s_code_size = cobs_encode(u8p_data, s_size_all, u8p_code, COBS_ENCODE_OUT_SIZE_MIN(s_size_all));
+    EXPECT_EQ(cobs_decode_parallel(u8p_code, s_code_size, u8p_out, s_size_all, COBS_MT_THREADS_MAX), s_size_all);
+    EXPECT_EQ(memcmp(u8p_out, u8p_data, s_size_all), 0);
+    free(u8p_data);
+    free(u8p_code);
+    free(u8p_out);
+}
+
+UTEST(cobs, decode_pool)
+{
+    static uint8_t u8a_data[4][16 * 700];
+    static uint8_t u8a_code[4][16 * COBS_ENCODE_OUT_SIZE_MIN(700)];
+    static frames_t sa_frames[4];
+    size_t sa_size[4][16];
+    size_t sa_code_size[4];
+    size_t sa_pushed[4];
+
+    for (unsigned u_threads = 1; u_threads <= 4; u_threads++)
+    {
+        cobs_pool_t *sp_pool = cobs_pool_create(u_threads, 4, 600, frames_collect_pool, sa_frames);
+        ASSERT_TRUE(sp_pool != NULL);
+        memset(sa_frames, 0, sizeof(sa_frames));
+        for (int j = 0; j < 4; j++)
+        {
+            size_t s_data_size = 0;
+            sa_code_size[j] = 0;
+            sa_pushed[j] = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                sa_size[j][i] = (size_t)(rand() % 700);
+                memrand(u8a_data[j] + s_data_size, sa_size[j][i], (unsigned)(i % 4) * 20);
+                sa_code_size[j] += cobs_encode(u8a_data[j] + s_data_size, sa_size[j][i], u8a_code[j] + sa_code_size[j],
+                                               sizeof(u8a_code[j]) - sa_code_size[j]);
+                s_data_size += sa_size[j][i];
+            }
+        }
+        /* Sources interleaved, chunks split frames anywhere. */
+        for (int k = 0; k < 1000; k++)
+        {
+            int j = rand() % 4;
+            size_t s_chunk = (size_t)(rand() % 300);
+            if (s_chunk > (sa_code_size[j] - sa_pushed[j]))
+            {
+                s_chunk = sa_code_size[j] - sa_pushed[j];
+            }
+            cobs_pool_push(sp_pool, (unsigned)j, u8a_code[j] + sa_pushed[j], s_chunk);
+            sa_pushed[j] += s_chunk;
+        }
+        for (int j = 0; j < 4; j++)
+        {
+            cobs_pool_push(sp_pool, (unsigned)j, u8a_code[j] + sa_pushed[j], sa_code_size[j] - sa_pushed[j]);
+        }
+        cobs_pool_flush(sp_pool);
+
+        for (int j = 0; j < 4; j++)
+        {
+            size_t s_data_size = 0;
+            size_t s_used = 0;
+            ASSERT_EQ(sa_frames[j].s_frames, 16);
+            for (int i = 0; i < 16; i++)
+            {
+                if (cobs_encoded_size(u8a_data[j] + s_data_size, sa_size[j][i]) > COBS_ENCODE_OUT_SIZE_MIN(600))
+                {
+                    /* Oversized frames are reported in order. */
+                    ASSERT_EQ(sa_frames[j].ia_status[i], COBS_FRAME_INVALID);
+                    ASSERT_EQ(sa_frames[j].sa_size[i], 0);
+                }
+                else
+                {
+                    ASSERT_EQ(sa_frames[j].ia_status[i], COBS_FRAME_OK);
+                    ASSERT_EQ(sa_frames[j].sa_size[i], sa_size[j][i]);
+                    ASSERT_EQ(memcmp(sa_frames[j].u8a_data + s_used, u8a_data[j] + s_data_size, sa_size[j][i]), 0);
+                    s_used += sa_size[j][i];
+                }
+                s_data_size += sa_size[j][i];
+            }
+        }
+        cobs_pool_destroy(sp_pool);
+    }
+
+    /* Frames are classified as by cobs_decode_many(). */
+    const uint8_t u8a_odd[] = {0x01, 0x00, 0x05, 0x00, 0x05, 0x11, 0x00, 0x02, 0x11, 0x00, 0x02, 0x11, 0x01, 0x00};
+    cobs_frame_t sa_many[8];
+    uint8_t u8a_out[16];
+    size_t s_many = cobs_decode_many(u8a_odd, sizeof(u8a_odd), u8a_out, sizeof(u8a_out), sa_many, 8, NULL);
+    cobs_pool_t *sp_pool = cobs_pool_create(2, 1, 600, frames_collect_pool, sa_frames);
+    ASSERT_TRUE(sp_pool != NULL);
+    memset(sa_frames, 0, sizeof(sa_frames));
+    cobs_pool_push(sp_pool, 0, u8a_odd, sizeof(u8a_odd));
+    cobs_pool_flush(sp_pool);
+    ASSERT_EQ(s_many, 5);
+    ASSERT_EQ(sa_frames[0].s_frames, s_many);
+    for (size_t i = 0; i < s_many; i++)
+    {
+        EXPECT_EQ(sa_frames[0].ia_status[i], sa_many[i].i_status);
+        EXPECT_EQ(sa_frames[0].sa_size[i], sa_many[i].s_size);
+    }
+    EXPECT_EQ(sa_many[1].i_status, COBS_FRAME_OK);
+    EXPECT_EQ(sa_many[1].s_size, 0);
+    cobs_pool_destroy(sp_pool);
+}
+
+UTEST(cobs, decode_pool_concurrent)
+{
+    static pool_sources_t s_sources;
+    const uint8_t u8a_frame[] = {0x02, 0x33, 0x00};
+    pthread_t s_thread;
+
+    s_sources.sp_pool = cobs_pool_create(2, 2, 16, pool_count, &s_sources);
+    ASSERT_TRUE(s_sources.sp_pool != NULL);
+    atomic_store(&s_sources.i_stop, 0);
+    ASSERT_EQ(pthread_create(&s_thread, NULL, pool_push_loop, &s_sources), 0);
+    for (size_t k = 1; k <= 20000; k++)
+    {
+        cobs_pool_push(s_sources.sp_pool, 1, u8a_frame, sizeof(u8a_frame));
+        cobs_pool_flush(s_sources.sp_pool);
+        /* Flush returns only once the frame of source 1 was delivered. */
+        ASSERT_EQ(s_sources.sa_delivered[1], k);
+    }
+    atomic_store(&s_sources.i_stop, 1);
+    pthread_join(s_thread, NULL);
+    cobs_pool_destroy(s_sources.sp_pool);
+}
+
+UTEST(cobs, ring)
+{
+    static uint8_t u8a_buf[1024];
+    static uint8_t u8a_data[300];
+    static uint8_t u8a_out[300];
+    static ring_frames_t s_frames;
+    const uint8_t u8a_small[] = {0x00, 0x03, 0x11, 0x22, 0x00, 0x00, 0x02, 0x33};
+    cobs_ring_t s_ring;
+    pthread_t s_thread;
+    size_t s_size;
+
+    ASSERT_FALSE(cobs_ring_init(&s_ring, u8a_buf, 1000));
+    ASSERT_TRUE(cobs_ring_init(&s_ring, u8a_buf, sizeof(u8a_buf)));
+
+    /* Lone frame ends are skipped, incomplete frames wait for more data. */
+    ASSERT_EQ(cobs_ring_write(&s_ring, u8a_small, sizeof(u8a_small)), sizeof(u8a_small));
+    ASSERT_TRUE(cobs_ring_read(&s_ring, u8a_out, sizeof(u8a_out), &s_size));
+    ASSERT_EQ(s_size, 2);
+    ASSERT_FALSE(cobs_ring_read(&s_ring, u8a_out, sizeof(u8a_out), &s_size));
+    ASSERT_EQ(cobs_ring_write(&s_ring, u8a_small, 1), 1);
+    ASSERT_TRUE(cobs_ring_read(&s_ring, u8a_out, sizeof(u8a_out), &s_size));
+    ASSERT_EQ(s_size, 1);
+    ASSERT_EQ(u8a_out[0], 0x33);
+
+    /* Frame longer than the ring is skipped. */
+    memset(u8a_data, 0x11, sizeof(u8a_data));
+    for (int i = 0; i < 4; i++)
+    {
+        ASSERT_GT(cobs_ring_write(&s_ring, u8a_data, 300), 0);
+        ASSERT_FALSE(cobs_ring_read(&s_ring, u8a_out, sizeof(u8a_out), &s_size));
+    }
+    ASSERT_EQ(cobs_ring_write(&s_ring, u8a_small, 5), 5);
+    ASSERT_TRUE(cobs_ring_read(&s_ring, u8a_out, sizeof(u8a_out), &s_size));
+    ASSERT_EQ(s_size, 2);
+
+    /* Producer thread, frames wrap around the ring end. */
+    for (int k = 0; k < 2000; k++)
+    {
+        s_frames.sa_size[k] = (size_t)(rand() % 300);
+        memrand(s_frames.u8a_data[k], s_frames.sa_size[k], (unsigned)(k % 5) * 10);
+    }
+    ASSERT_TRUE(cobs_ring_init(&s_frames.s_ring, u8a_buf, sizeof(u8a_buf)));
+    ASSERT_EQ(pthread_create(&s_thread, NULL, ring_produce, &s_frames), 0);
+    for (int k = 0; k < 2000; k++)
+    {
+        while (!cobs_ring_read(&s_frames.s_ring, u8a_out, sizeof(u8a_out), &s_size))
+        {
+            sched_yield();
+        }
+        ASSERT_EQ(s_size, s_frames.sa_size[k]);
+        ASSERT_EQ(memcmp(u8a_out, s_frames.u8a_data[k], s_size), 0);
+    }
+    pthread_join(s_thread, NULL);
+}
+
+UTEST(cobs, tx_ring)
+{
+    static uint8_t u8a_buf[COBS_TX_RING_BUF_SIZE(4096, 304)];
+    static cobs_frame_t sa_frames[4 * 2000];
+    const size_t s_wire_max = 4 * 2000 * COBS_ENCODE_OUT_SIZE_MIN(304);
+    uint8_t *u8p_wire = malloc(s_wire_max);
+    uint8_t *u8p_out = malloc(s_wire_max);
+    uint8_t u8a_data[304];
+    cobs_tx_ring_t s_ring;
+    pthread_t ta_thread[4];
+    tx_sender_t sa_sender[4];
+    unsigned ua_seq[4] = {0};
+    size_t s_wire_size = 0;
+    size_t s_in_used;
+    ASSERT_TRUE((u8p_wire != NULL) && (u8p_out != NULL));
+
+    ASSERT_FALSE(cobs_tx_ring_init(&s_ring, u8a_buf, 4000, 304));
+    ASSERT_FALSE(cobs_tx_ring_init(&s_ring, u8a_buf, 256, 304));
+    ASSERT_TRUE(cobs_tx_ring_init(&s_ring, u8a_buf, 4096, 304));
+    EXPECT_EQ(cobs_tx_ring_send(&s_ring, u8a_data, 305), 0);
+    for (unsigned i = 0; i < 4; i++)
+    {
+        sa_sender[i].sp_ring = &s_ring;
+        sa_sender[i].u_thread = i;
+        ASSERT_EQ(pthread_create(&ta_thread[i], NULL, tx_send, &sa_sender[i]), 0);
+    }
+    /* Drain until all reservations are sent. */
+    size_t s_wire_exp = 0;
+    for (unsigned i = 0; i < 4; i++)
+    {
+        for (unsigned u_seq = 0; u_seq < 2000; u_seq++)
+        {
+            s_wire_exp += COBS_ENCODE_OUT_SIZE_MIN(tx_frame(u8a_data, i, u_seq));
+        }
+    }
+    while (s_wire_size < s_wire_exp)
+    {
+        size_t s_size;
+        const uint8_t *u8p_span = cobs_tx_ring_drain_begin(&s_ring, &s_size);
+        ASSERT_LE(s_wire_size + s_size, s_wire_exp);
+        memcpy(u8p_wire + s_wire_size, u8p_span, s_size);
+        s_wire_size += s_size;
+        cobs_tx_ring_drain_end(&s_ring, s_size);
+        if (s_size == 0)
+        {
+            sched_yield();
+        }
+    }
+    for (unsigned i = 0; i < 4; i++)
+    {
+        pthread_join(ta_thread[i], NULL);
+    }
+
+    /* Frames of every sender arrive complete and in order. */
+    size_t s_frames = cobs_decode_many(u8p_wire, s_wire_size, u8p_out, s_wire_max,
+                                       sa_frames, 4 * 2000, &s_in_used);
+    ASSERT_EQ(s_frames, 4 * 2000);
+    ASSERT_EQ(s_in_used, s_wire_size);
+    for (size_t i = 0; i < s_frames; i++)
+    {
+        const uint8_t *u8p_frame = u8p_out + sa_frames[i].s_offset;
+        unsigned u_thread = u8p_frame[0];
+        ASSERT_LT(u_thread, 4);
+        size_t s_size = tx_frame(u8a_data, u_thread, ua_seq[u_thread]++);
+        ASSERT_EQ(sa_frames[i].s_size, s_size);
+        ASSERT_EQ(memcmp(u8p_frame, u8a_data, s_size), 0);
+    }
+    free(u8p_wire);
+    free(u8p_out);
+}
+
+UTEST(cobs, kernel_select)
+{
+    const char *cp_best = cobs_kernel_name();
+    const char *cp_env = getenv("COBS_KERNEL");
+
+    if ((cp_env != NULL) && cobs_kernel_set(cp_env))
+    {
+        /* Earlier tests left the kernel of this run selected. */
+        EXPECT_EQ(strcmp(cp_best, cp_env), 0);
+    }
+    cobs_kernel_set(cp_best);
+    EXPECT_TRUE(cobs_kernel_set("scalar"));
+    EXPECT_EQ(strcmp(cobs_kernel_name(), "scalar"), 0);
+    EXPECT_FALSE(cobs_kernel_set("no-such-kernel"));
+    EXPECT_EQ(strcmp(cobs_kernel_name(), "scalar"), 0);
+    EXPECT_TRUE(cobs_kernel_set(NULL));
+    if (cp_env == NULL)
+    {
+        EXPECT_EQ(strcmp(cobs_kernel_name(), cp_best), 0);
+    }
+    EXPECT_NE(strcmp(cobs_kernel_name(), "no-such-kernel"), 0);
+    cobs_kernel_set(cp_best);
+}
+
 /*==============================================================================
  TEST MAIN
  =============================================================================*/